@@ -0,0 +1,97 @@
+#include <type_traits>
+
+//--------------------------------------------------------
+// Arena
+//--------------------------------------------------------
+// Bump allokator: a kereseket nagy, ARRAY_ALIGNMENT-re igazitott blokkokbol, egymas utan, a foglalas
+// sorrendjeben szolgalja ki, egyenkent nem szabadit fel semmit. A reset (es a destruktor) minden blokkot
+// egyszerre ad vissza, ezert csak trivialisan megszuntetheto tipusok kerulhetnek bele.
+class Arena {
+    static const size_t BLOCK_SIZE = 1 << 20;
+
+    struct Block {
+        Block *next;
+        size_t size;
+        size_t used;
+    };
+
+    Block *blocks;
+    size_t total;
+
+    // A blokk fejlece utani elso igazitott cim
+    static char *payload(Block *b) {
+        return reinterpret_cast<char *>(b) + ARRAY_ALIGNMENT;
+    }
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    Block *newBlock(size_t size) {
+        Block *b = static_cast<Block *>(alignedAlloc(ARRAY_ALIGNMENT + size));
+        b->size = size;
+        b->used = 0;
+        b->next = NULL;
+        return b;
+    }
+
+    void *allocateBytes(size_t bytes) {
+        bytes = (bytes + ARRAY_ALIGNMENT - 1) & ~(ARRAY_ALIGNMENT - 1);
+        total += bytes;
+
+        // A nagy keresek sajat blokkot kapnak az aktualis moge, igy annak maradek helye a kis keresekre marad
+        if (bytes > BLOCK_SIZE / 4) {
+            Block *b = newBlock(bytes);
+            b->used = bytes;
+            if (blocks != NULL) {
+                b->next = blocks->next;
+                blocks->next = b;
+            } else {
+                blocks = b;
+            }
+            return payload(b);
+        }
+
+        if (blocks == NULL || blocks->size - blocks->used < bytes) {
+            Block *b = newBlock(BLOCK_SIZE);
+            b->next = blocks;
+            blocks = b;
+        }
+        void *p = payload(blocks) + blocks->used;
+        blocks->used += bytes;
+        return p;
+    }
+
+public:
+    Arena() : blocks(NULL), total(0) {
+    }
+
+    // count darab alapertelmezetten konstrualt T, folytonosan, ARRAY_ALIGNMENT-re igazitva
+    template<class T>
+    T *allocate(int count) {
+        static_assert(std::is_trivially_destructible<T>::value, "Arena: the destructor would never run");
+        if (count < 0 || (size_t) count > ((size_t) -1 - ARRAY_ALIGNMENT) / sizeof(T))
+            throw std::length_error("Arena: allocation too large");
+        T *p = static_cast<T *>(allocateBytes((size_t) (count > 0 ? count : 1) * sizeof(T)));
+        for (int i = 0; i < count; i++)
+            new(p + i) T();
+        return p;
+    }
+
+    // Az osszes eddigi foglalas egyszerre ervenytelenne valik
+    void reset() {
+        while (blocks != NULL) {
+            Block *next = blocks->next;
+            alignedFree(blocks);
+            blocks = next;
+        }
+        total = 0;
+    }
+
+    size_t bytesUsed() {
+        return total;
+    }
+
+    ~Arena() {
+        reset();
+    }
+};
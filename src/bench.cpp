@@ -0,0 +1,157 @@
+//=============================================================================================
+// Mikrobenchmark: egy sugar sok gombbal szemben, a SphereSet SIMD kernele es a handle-onkenti
+// ObjectStore::intersect hivasok osszehasonlitasa. Elotte a peldanyositott alakok dobozait is ellenorzi.
+//
+// Hasznalat: grafika-bench [--spheres N] [--rays M] [--repeat R]
+//=============================================================================================
+
+#include "imps.cpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+struct BenchOptions {
+    int spheres;
+    int rays;
+    int repeat;
+
+    BenchOptions() : spheres(64), rays(100000), repeat(5) {
+    }
+};
+
+static void usage() {
+    fprintf(stderr, "usage: grafika-bench [--spheres N] [--rays M] [--repeat R]\n");
+}
+
+static bool parseOptions(int argc, char **argv, BenchOptions &options) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (i + 1 >= argc) return false;
+        int value = atoi(argv[++i]);
+
+        if (strcmp(arg, "--spheres") == 0) options.spheres = value;
+        else if (strcmp(arg, "--rays") == 0) options.rays = value;
+        else if (strcmp(arg, "--repeat") == 0) options.repeat = value;
+        else return false;
+    }
+    return options.spheres > 0 && options.rays > 0 && options.repeat > 0;
+}
+
+// Determinisztikus, platformfuggetlen [0, 1) veletlenszamok
+static unsigned int seed = 12345;
+
+static float random01() {
+    seed = seed * 1664525u + 1013904223u;
+    return (seed >> 8) * (1.0f / 16777216.0f);
+}
+
+// A peldanyositott gomb alakok doboza: a(x^2 + y^2 + z^2 - 1) = 0 egysegsugaru gomb qxx = a != 1 eseten is (negativ
+// a-val is) tartalmazza a felulet pontjait
+static bool checkPartBounds() {
+    ObjectStore objects;
+    MaterialIndex surface = objects.addMaterial(Surface(Color(1.0f, 1.0f, 1.0f), Color(), 1.0f, false, false));
+    const float coefficients[2] = {4.0f, -2.0f};
+    for (int s = 0; s < 2; s++) {
+        QMatrix Q;
+        Q.m[0][0] = Q.m[1][1] = Q.m[2][2] = coefficients[s];
+        Q.m[3][3] = -coefficients[s];
+        Point origin(1.0f, 2.0f, 3.0f);
+        ObjectHandle part = objects.addPart(surface, objects.addShape(Q), origin, Vector(1.0f, 1.0f, 0.0f), 1.5f);
+
+        AABB box;
+        if (!objects.getBounds(part, box))
+            return false;
+        for (int i = 0; i <= 16; i++) {
+            for (int j = 0; j < 32; j++) {
+                float theta = (float) M_PI * i / 16.0f, phi = 2.0f * (float) M_PI * j / 32.0f;
+                Point p = origin + Vector(sinf(theta) * cosf(phi), sinf(theta) * sinf(phi), cosf(theta)) * 1.5f;
+                for (int a = 0; a < 3; a++) {
+                    if (!(p[a] >= box.pmin[a] - 1e-4f && p[a] <= box.pmax[a] + 1e-4f))
+                        return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv) {
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        usage();
+        return 1;
+    }
+    if (!checkPartBounds()) {
+        fprintf(stderr, "part bounds do not contain the part\n");
+        return 1;
+    }
+
+    // Gombok egy 10x10x10-es kockaban, a sugarak a kocka elotti sikbol indulnak feleje
+    ObjectStore objects;
+    objects.reserve(OBJECT_SPHERE, options.spheres);
+    MaterialIndex surface = objects.addMaterial(Surface(Color(1.0f, 1.0f, 1.0f), Color(), 1.0f, false, false));
+    SphereSet set;
+    for (int i = 0; i < options.spheres; i++) {
+        Point center(random01() * 10.0f, random01() * 10.0f, random01() * 10.0f);
+        float r = 0.2f + random01() * 0.8f;
+        set.push(center, r, objects.addSphere(surface, r, center));
+    }
+    set.pad();
+
+    std::vector<Ray> rays;
+    rays.reserve(options.rays);
+    for (int i = 0; i < options.rays; i++) {
+        Point origin(random01() * 10.0f, random01() * 10.0f, -10.0f);
+        Point target(random01() * 10.0f, random01() * 10.0f, 10.0f);
+        rays.push_back(Ray(origin, (target - origin).normalize()));
+    }
+
+    // Mindket ut a legkozelebbi talalatot keresi. Elterni csak surlodo sugaraknal lehet, ahol a skalar ut
+    // befoglalo gomb tesztje (intersectBV) mas kerekitessel dont, mint a diszkriminans.
+    int scalarHits = 0, simdHits = 0, mismatches = 0;
+    double scalarSeconds = 0.0, simdSeconds = 0.0;
+    std::vector<ObjectHandle> scalarObject(options.rays);
+    for (int rep = 0; rep < options.repeat; rep++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        scalarHits = 0;
+        for (int i = 0; i < options.rays; i++) {
+            float t = FLOAT_MAX, tTemp;
+            scalarObject[i] = NO_OBJECT;
+            for (int j = 0; j < objects.size(); j++) {
+                ObjectHandle h = objects.handle(j);
+                if (objects.intersect(h, rays[i], tTemp) && tTemp > RAY_EPSILON && tTemp < t) {
+                    t = tTemp;
+                    scalarObject[i] = h;
+                }
+            }
+            scalarHits += scalarObject[i] != NO_OBJECT;
+        }
+        scalarSeconds += secondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        simdHits = mismatches = 0;
+        for (int i = 0; i < options.rays; i++) {
+            float t = FLOAT_MAX;
+            ObjectHandle o = NO_OBJECT;
+            simdHits += set.intersect(0, set.size(), rays[i], RAY_EPSILON, t, o);
+            mismatches += o != scalarObject[i];
+        }
+        simdSeconds += secondsSince(start);
+    }
+
+    double tests = (double) options.rays * options.spheres * options.repeat;
+    printf("%d spheres, %d rays x %d, SIMD lanes: %d\n", options.spheres, options.rays, options.repeat, SPHERE_LANES);
+    printf("ObjectStore::intersect:    %8.3f ms  %6.2f ns/test  %d hits\n",
+           scalarSeconds * 1000.0, scalarSeconds * 1e9 / tests, scalarHits);
+    printf("SphereSet::intersect:      %8.3f ms  %6.2f ns/test  %d hits\n",
+           simdSeconds * 1000.0, simdSeconds * 1e9 / tests, simdHits);
+    printf("speedup: %.2fx, mismatches: %d\n", scalarSeconds / simdSeconds, mismatches);
+
+    return 0;
+}
@@ -0,0 +1,1718 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+//--------------------------------------------------------
+// BVH (Bounding Volume Hierarchy)
+//--------------------------------------------------------
+struct BVHNode {
+    AABB box;
+    int offset;    // level: elso primitiv indexe, belso csucs: jobb gyerek indexe (a bal mindig node + 1)
+    int count;     // belso csucsnal 0
+    int sphereFirst;    // level: a gombjai ettol a SphereSet indextol kezdodnek
+    int sphereCount;    // level: a primitivjei kozul az elso sphereCount gomb, ezeket a SphereSet metszi
+};
+
+// Epitesi modszer: a binned SAH jobb fat ad, az LBVH gyorsabban epul, ami minden kepkockaban ujraepulo vagy
+// generatorbol jovo jelenetnel szamit; a treelet-optimalizalas a ketto kozott van
+enum BVHBuilder {
+    BVH_BINNED_SAH,
+    BVH_LBVH        // a kozeppontok Morton-kodja szerint rendezve, a kodok bitjei menten vagva
+};
+
+struct BVHBuildOptions {
+    BVHBuilder builder;
+    int mortonBits;       // LBVH: 30 vagy 63 bites Morton-kod; a 30 bites feleannyi rendezesi menet, de durvabb racs
+    int treeletRounds;    // LBVH: a treelet-optimalizalas menetei, 0 eseten nincs
+    int threads;          // az epitest vegzo szalak szama, 0 eseten ahany mag van; kis fanal mindig egy szal dolgozik
+    int width;            // 4 vagy 8: a skalaris sugarak szeles csucsokat jarnak be, 2: csak a binaris fa
+    int quantizationBits; // a szeles csucsok gyerekdobozai: 8 vagy 16 bit tengelyenkent
+    float rebuildThreshold;    // World::refit ujraepit, ha a SAH koltseg ennyiszeresere nott az epiteskorihoz kepest (0: soha)
+
+    BVHBuildOptions() : builder(BVH_BINNED_SAH), mortonBits(63), treeletRounds(0), threads(0), width(2),
+                        quantizationBits(8), rebuildThreshold(1.5f) {
+    }
+};
+
+// Az utolso epites adatai. A SAH koltseg a csucsok feluletevel, a gyoker feluletere normalva sulyozott osszeg:
+// belso csucsonkent 0.125 (bejaras), levelenkent a primitivek szama (metszes), ugyanaz, amivel az epito vag.
+struct BVHBuildStats {
+    BVHBuilder builder;    // LBVH helyett binned SAH, ha a Morton-fa tul mely lett volna a bejaras vermehez
+    double seconds;
+    int threads;
+    int primitives;
+    int nodes;
+    int leaves;
+    float sahCost;
+    int width;            // a szeles csucsok aga, 2 ha nincsenek
+    int wideNodes;
+    int wideNodeBytes;    // egy szeles csucs merete (egy binaris csucse sizeof(BVHNode))
+
+    BVHBuildStats() : builder(BVH_BINNED_SAH), seconds(0.0), threads(1), primitives(0), nodes(0), leaves(0), sahCost(0.0f),
+                      width(2), wideNodes(0), wideNodeBytes(0) {
+    }
+};
+
+struct BVHPrimitive {
+    AABB box;
+    Point centroid;
+    ObjectHandle object;
+};
+
+// Sugarcsomag befoglalo "frustuma": az origok es az inverz iranyok tengelyenkenti intervalluma.
+// Intervallum-aritmetikaval egyetlen teszt donti el, hogy a csomag egyik sugara sem talalhatja el a dobozt.
+struct PacketFrustum {
+    alignas(32) float invx[PACKET_SIZE];
+    alignas(32) float invy[PACKET_SIZE];
+    alignas(32) float invz[PACKET_SIZE];
+    float omin[3], omax[3];
+    float imin[3], imax[3];
+
+    PacketFrustum(RayPacket &p) {
+        for (int a = 0; a < 3; a++) {
+            omin[a] = imin[a] = FLOAT_MAX;
+            omax[a] = imax[a] = -FLOAT_MAX;
+        }
+        for (int i = 0; i < PACKET_SIZE; i++) {
+            Vector inv = Vector(p.dx[i], p.dy[i], p.dz[i]).inverse();
+            invx[i] = inv.x;
+            invy[i] = inv.y;
+            invz[i] = inv.z;
+            if (!p.active[i]) continue;
+
+            float o[3] = {p.ox[i], p.oy[i], p.oz[i]};
+            for (int a = 0; a < 3; a++) {
+                omin[a] = minf(omin[a], o[a]);
+                omax[a] = maxf(omax[a], o[a]);
+                imin[a] = minf(imin[a], inv[a]);
+                imax[a] = maxf(imax[a], inv[a]);
+            }
+        }
+    }
+
+    bool missesAll(const AABB &box, float tmax) {
+        float entry = -FLOAT_MAX, exit = FLOAT_MAX;
+        for (int a = 0; a < 3; a++) {
+            // (b - o) * inv szorzat szelsoertekei az intervallumok sarkaiban vannak
+            float n0 = (box.pmin[a] - omax[a]) * imin[a], n1 = (box.pmin[a] - omax[a]) * imax[a];
+            float n2 = (box.pmin[a] - omin[a]) * imin[a], n3 = (box.pmin[a] - omin[a]) * imax[a];
+            float f0 = (box.pmax[a] - omax[a]) * imin[a], f1 = (box.pmax[a] - omax[a]) * imax[a];
+            float f2 = (box.pmax[a] - omin[a]) * imin[a], f3 = (box.pmax[a] - omin[a]) * imax[a];
+            float lo = minf(minf(minf(n0, n1), minf(n2, n3)), minf(minf(f0, f1), minf(f2, f3)));
+            float hi = maxf(maxf(maxf(n0, n1), maxf(n2, n3)), maxf(maxf(f0, f1), maxf(f2, f3)));
+            entry = maxf(entry, lo);
+            exit = minf(exit, hi);
+        }
+        return entry > exit * 1.0000004f || exit < RAY_EPSILON || entry >= tmax;
+    }
+};
+
+//--------------------------------------------------------
+// Szeles (4 vagy 8 agu) BVH csucsok
+//--------------------------------------------------------
+// A binaris fa osszevonasaval keszulnek: egy csucs legfeljebb W gyereket tart, a gyerekdobozok SoA-ban, a csucs
+// dobozahoz kepest Q tipusu (8 vagy 16 bites) egeszekre kvantalva. A kvantalt doboz mindig tartalmazza az eredetit:
+// a kvantalas ugyanazzal a float muvelettel (origin + q * scale) ellenoriz, amivel a bejaras visszaalakit.
+// A csucs osszes gyerekere egyetlen SIMD slab teszt fut.
+template<int W, class Q>
+struct WideNode {
+    float origin[3], scale[3];
+    Q lo[3][W], hi[3][W];
+    int child[W];       // belso gyereknel a szeles csucs indexe, levelnel a binaris level indexe
+    int binary;         // a binaris csucs, amibol a szeles csucs lett; refit utan ennek a dobozahoz kvantalunk ujra
+    unsigned char childMask, leafMask;
+};
+
+struct WideRay {
+    float o[3], inv[3];
+
+    WideRay(Ray &ray) {
+        Vector inverse = ray.v.inverse();
+        for (int a = 0; a < 3; a++) {
+            o[a] = ray.p0[a];
+            inv[a] = inverse[a];
+        }
+    }
+};
+
+// Savonkent ugyanaz a feltetel, mint AABB::intersect-ben; a talalt gyerekek bitmaszkja, tnear a belepesi pontok
+template<int W, class Q>
+inline int slabTestLanes(const WideNode<W, Q> &node, const WideRay &r, float tmin, float tmax, float *tnear) {
+    int mask = 0;
+    for (int i = 0; i < W; i++) {
+        float t0 = -FLOAT_MAX, t1 = FLOAT_MAX;
+        for (int a = 0; a < 3; a++) {
+            float n = (node.origin[a] + node.lo[a][i] * node.scale[a] - r.o[a]) * r.inv[a];
+            float f = (node.origin[a] + node.hi[a][i] * node.scale[a] - r.o[a]) * r.inv[a];
+            t0 = maxf(t0, minf(n, f));
+            t1 = minf(t1, maxf(n, f));
+        }
+        t1 *= 1.0000004f;
+        tnear[i] = t0;
+        mask |= (t0 <= t1 && t1 > tmin && t0 < tmax) << i;
+    }
+    return mask & node.childMask;
+}
+
+#if defined(__AVX2__)
+inline __m256 widenLanes(const uint8_t *q) {
+    return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) q)));
+}
+
+inline __m256 widenLanes(const uint16_t *q) {
+    return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *) q)));
+}
+#endif
+
+#if defined(__SSE4_1__)
+inline __m128 widenLanes4(const uint8_t *q) {
+    int packed;
+    memcpy(&packed, q, sizeof(packed));
+    return _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed)));
+}
+
+inline __m128 widenLanes4(const uint16_t *q) {
+    return _mm_cvtepi32_ps(_mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i *) q)));
+}
+#endif
+
+template<class Q>
+inline int slabTest(const WideNode<8, Q> &node, const WideRay &r, float tmin, float tmax, float *tnear) {
+#if defined(__AVX2__)
+    __m256 t0 = _mm256_set1_ps(-FLOAT_MAX), t1 = _mm256_set1_ps(FLOAT_MAX);
+    for (int a = 0; a < 3; a++) {
+        __m256 origin = _mm256_set1_ps(node.origin[a]), scale = _mm256_set1_ps(node.scale[a]);
+        __m256 o = _mm256_set1_ps(r.o[a]), inv = _mm256_set1_ps(r.inv[a]);
+        __m256 n = _mm256_mul_ps(_mm256_sub_ps(_mm256_add_ps(origin, _mm256_mul_ps(widenLanes(node.lo[a]), scale)), o), inv);
+        __m256 f = _mm256_mul_ps(_mm256_sub_ps(_mm256_add_ps(origin, _mm256_mul_ps(widenLanes(node.hi[a]), scale)), o), inv);
+        t0 = _mm256_max_ps(t0, _mm256_min_ps(n, f));
+        t1 = _mm256_min_ps(t1, _mm256_max_ps(n, f));
+    }
+    t1 = _mm256_mul_ps(t1, _mm256_set1_ps(1.0000004f));
+    __m256 hit = _mm256_and_ps(_mm256_cmp_ps(t0, t1, _CMP_LE_OQ),
+                               _mm256_and_ps(_mm256_cmp_ps(t1, _mm256_set1_ps(tmin), _CMP_GT_OQ),
+                                             _mm256_cmp_ps(t0, _mm256_set1_ps(tmax), _CMP_LT_OQ)));
+    _mm256_storeu_ps(tnear, t0);
+    return _mm256_movemask_ps(hit) & node.childMask;
+#else
+    return slabTestLanes(node, r, tmin, tmax, tnear);
+#endif
+}
+
+template<class Q>
+inline int slabTest(const WideNode<4, Q> &node, const WideRay &r, float tmin, float tmax, float *tnear) {
+#if defined(__SSE4_1__)
+    __m128 t0 = _mm_set1_ps(-FLOAT_MAX), t1 = _mm_set1_ps(FLOAT_MAX);
+    for (int a = 0; a < 3; a++) {
+        __m128 origin = _mm_set1_ps(node.origin[a]), scale = _mm_set1_ps(node.scale[a]);
+        __m128 o = _mm_set1_ps(r.o[a]), inv = _mm_set1_ps(r.inv[a]);
+        __m128 n = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(origin, _mm_mul_ps(widenLanes4(node.lo[a]), scale)), o), inv);
+        __m128 f = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(origin, _mm_mul_ps(widenLanes4(node.hi[a]), scale)), o), inv);
+        t0 = _mm_max_ps(t0, _mm_min_ps(n, f));
+        t1 = _mm_min_ps(t1, _mm_max_ps(n, f));
+    }
+    t1 = _mm_mul_ps(t1, _mm_set1_ps(1.0000004f));
+    __m128 hit = _mm_and_ps(_mm_cmple_ps(t0, t1),
+                            _mm_and_ps(_mm_cmpgt_ps(t1, _mm_set1_ps(tmin)), _mm_cmplt_ps(t0, _mm_set1_ps(tmax))));
+    _mm_storeu_ps(tnear, t0);
+    return _mm_movemask_ps(hit) & node.childMask;
+#else
+    return slabTestLanes(node, r, tmin, tmax, tnear);
+#endif
+}
+
+class BVH {
+    static const int MAX_LEAF_SIZE = 8;
+    static const int MAX_DEPTH = 40;
+    static const int STACK_SIZE = 64;
+    static const int BINS = 16;
+    static const int SWEEP_MAX = 64;    // ennyi primitivig a pontos, rendezeses SAH dont
+    static const int PARALLEL_MIN = 4096;    // ennel kisebb csucsot mar egy szal vag, ennyinel kevesebb primitivre nem indul szal
+    static const int WIDE_STACK = STACK_SIZE * 8;    // csucsonkent legfeljebb 8 bejegyzes kerul a verembe
+
+    ObjectStore *store;
+    BVHNode *nodes;
+    int nodeCount;
+    ObjectHandle *prims;
+    int primCount;
+    ObjectHandle *unbounded;
+    int unboundedCount;
+    SphereSet spheres;
+    BVHBuildStats stats;
+    void *wide;         // WideNode<wideWidth, wideBits bites egesz> tomb az arenaban, NULL ha csak binaris fa van
+    int wideCount;
+    int wideWidth, wideBits;
+    double sahArea;     // a csucsok SAH-sulyozott feluletosszege; a gyoker feluletevel osztva az aktualis SAH koltseg
+    float builtCost;    // a SAH koltseg epiteskor, ehhez merjuk a refit okozta romlast
+
+    // A reszleges refithez, csak ha a fa mozgathato objektumot (peldanyt) tartalmaz
+    struct LeafRef {
+        ObjectHandle object;
+        int leaf;
+
+        bool operator<(const LeafRef &other) const {
+            return object < other.object;
+        }
+    };
+
+    LeafRef *movable;           // a peldanyok levelei, handle szerint rendezve
+    int movableCount;
+    int *parents;
+    int *wideOf;                // binaris csucs -> a belole lett szeles csucs, -1 ha nincs ilyen
+    unsigned char *dirty;
+
+    struct IsSphere {
+        bool operator()(const BVHPrimitive &p) const {
+            return handleType(p.object) == OBJECT_SPHERE;
+        }
+    };
+
+    struct CentroidLess {
+        int axis;
+
+        CentroidLess(int axis) : axis(axis) {
+        }
+
+        bool operator()(const BVHPrimitive &a, const BVHPrimitive &b) const {
+            return a.centroid[axis] < b.centroid[axis];
+        }
+    };
+
+    // A kozeppont vodre az axis tengely menten, es hogy a bin. vodortol balra esik-e; csak olyan tengelyre hasznalhato,
+    // ahol a kozeppontok doboza nem lapos. A vodrok kitoltese es a vagas ugyanazt a szamitast vegzi.
+    struct BinLess {
+        float origin, scale;
+        int axis, bin;
+
+        BinLess(const AABB &centroids, int axis, int bin)
+                : origin(centroids.pmin[axis]), scale((float) BINS / (centroids.pmax[axis] - centroids.pmin[axis])),
+                  axis(axis), bin(bin) {
+        }
+
+        int of(float c) const {
+            int b = (int) ((c - origin) * scale);
+            return b < 0 ? 0 : (b >= BINS ? BINS - 1 : b);
+        }
+
+        bool operator()(const BVHPrimitive &p) const {
+            return of(p.centroid[axis]) < bin;
+        }
+    };
+
+    // Binned SAH: a kozeppontok dobozat tengelyenkent BINS egyenlo reszre osztjuk, es csak a vodrok hatarain
+    // vizsgaljuk a vagast; rendezes helyett ket linearis menet, ami darabokra bontva tobb szalon is fut
+    struct Bins {
+        AABB box, centroids;
+        AABB binBox[3][BINS];
+        int binCount[3][BINS];
+
+        Bins() {
+            for (int a = 0; a < 3; a++)
+                for (int b = 0; b < BINS; b++)
+                    binCount[a][b] = 0;
+        }
+
+        void bound(const BVHPrimitive *refs, int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                box.grow(refs[i].box);
+                centroids.grow(refs[i].centroid);
+            }
+        }
+
+        void fill(const BVHPrimitive *refs, int begin, int end, const AABB &c) {
+            for (int a = 0; a < 3; a++) {
+                if (c.pmax[a] <= c.pmin[a]) continue;
+                BinLess bin(c, a, 0);
+                for (int i = begin; i < end; i++) {
+                    int b = bin.of(refs[i].centroid[a]);
+                    binBox[a][b].grow(refs[i].box);
+                    binCount[a][b]++;
+                }
+            }
+        }
+
+        // Ures doboz a grow-val nem olvaszthato be (a vegtelen sarkait venne at), ezert az ures vodroket atlepjuk
+        void merge(const Bins &o) {
+            for (int a = 0; a < 3; a++) {
+                for (int b = 0; b < BINS; b++) {
+                    if (o.binCount[a][b] == 0) continue;
+                    binBox[a][b].grow(o.binBox[a][b]);
+                    binCount[a][b] += o.binCount[a][b];
+                }
+            }
+        }
+    };
+
+    // Egy szal altal epitett reszfa: a csucsai a szal sajat arenajaban, melysegi sorrendben vannak, a belso csucsok
+    // offset-je a reszfan belul ertendo
+    struct Subtree {
+        int begin, end, depth;
+        BVHNode *nodes;
+        int nodeCount;
+    };
+
+    // [begin, end) threads egyenlo darabra osztva, darabonkent egy szalon: body(darab, eleje, vege)
+    template<class F>
+    static void parallelChunks(int begin, int end, int threads, F body) {
+        int chunk = (end - begin + threads - 1) / threads;
+        std::vector<std::thread> workers;
+        for (int t = 1; t < threads; t++)
+            workers.emplace_back(body, t, std::min(begin + t * chunk, end), std::min(begin + (t + 1) * chunk, end));
+        body(0, begin, std::min(begin + chunk, end));
+        for (size_t t = 0; t < workers.size(); t++)
+            workers[t].join();
+    }
+
+    // A vodrok kitoltese; nagy csucsnal (a fa felso szintjein) a primitiveket tobb szal dolgozza fel, a reszeredmenyek
+    // osszefesulese a szalak szamatol fuggetlenul ugyanazt adja
+    static void gather(const BVHPrimitive *refs, int begin, int end, int threads, Bins &bins) {
+        if (threads <= 1 || end - begin < PARALLEL_MIN) {
+            bins.bound(refs, begin, end);
+            bins.fill(refs, begin, end, bins.centroids);
+            return;
+        }
+
+        std::vector<Bins> parts(threads);
+        parallelChunks(begin, end, threads, [&](int t, int from, int to) {
+            parts[t].bound(refs, from, to);
+        });
+        for (int t = 0; t < threads; t++) {
+            if (parts[t].box.empty()) continue;
+            bins.box.grow(parts[t].box);
+            bins.centroids.grow(parts[t].centroids);
+        }
+
+        parallelChunks(begin, end, threads, [&](int t, int from, int to) {
+            parts[t] = Bins();
+            parts[t].fill(refs, from, to, bins.centroids);
+        });
+        for (int t = 0; t < threads; t++)
+            bins.merge(parts[t]);
+    }
+
+    // A [begin, end) primitiveket helyben ketteosztja, es a vagas indexevel ter vissza, vagy -1-gyel, ha level legyen
+    // belole; box a primitivek kozos doboza (uresen kell atadni)
+    static int split(BVHPrimitive *refs, int begin, int end, int depth, int threads, AABB &box) {
+        int count = end - begin;
+        if (count <= SWEEP_MAX)
+            return sweepSplit(refs, begin, end, depth, box);
+
+        Bins bins;
+        gather(refs, begin, end, threads, bins);
+        box = bins.box;
+
+        float leafCost = (float) count;
+        float bestCost = FLOAT_MAX;
+        int bestAxis = -1, bestBin = -1;
+
+        if (count > 1 && depth < MAX_DEPTH) {
+            float invArea = 1.0f / box.area();
+            for (int axis = 0; axis < 3; axis++) {
+                if (bins.centroids.pmax[axis] <= bins.centroids.pmin[axis]) continue;
+
+                float rightArea[BINS];
+                int rightCount[BINS];
+                AABB right;
+                int n = 0;
+                for (int b = BINS - 1; b > 0; b--) {
+                    if (bins.binCount[axis][b] > 0)
+                        right.grow(bins.binBox[axis][b]);
+                    n += bins.binCount[axis][b];
+                    rightArea[b] = right.area();
+                    rightCount[b] = n;
+                }
+
+                // A b. vodor hatara: tole balra a bal, tole jobbra (vele egyutt) a jobb oldal
+                AABB left;
+                n = 0;
+                for (int b = 1; b < BINS; b++) {
+                    if (bins.binCount[axis][b - 1] > 0)
+                        left.grow(bins.binBox[axis][b - 1]);
+                    n += bins.binCount[axis][b - 1];
+                    if (n == 0 || rightCount[b] == 0) continue;
+                    float cost = 0.125f + (left.area() * n + rightArea[b] * rightCount[b]) * invArea;
+                    if (cost < bestCost) {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestBin = b;
+                    }
+                }
+            }
+        }
+
+        if (bestAxis < 0 && count > MAX_LEAF_SIZE)
+            return medianSplit(refs, begin, end, bins.centroids);
+        if (bestAxis < 0 || (bestCost >= leafCost && count <= MAX_LEAF_SIZE))
+            return -1;
+
+        return (int) (std::partition(refs + begin, refs + end, BinLess(bins.centroids, bestAxis, bestBin)) - refs);
+    }
+
+    // Kis csucsnal a vodrok feltoltese dragabb lenne, mint a rendezes: itt a pontos SAH, minden tengely menten
+    // rendezett sorrendben vegigsopruve
+    static int sweepSplit(BVHPrimitive *refs, int begin, int end, int depth, AABB &box) {
+        int count = end - begin;
+        AABB centroids;
+        for (int i = begin; i < end; i++) {
+            box.grow(refs[i].box);
+            centroids.grow(refs[i].centroid);
+        }
+
+        float leafCost = (float) count;
+        float bestCost = FLOAT_MAX;
+        int bestAxis = -1, bestSplit = -1;
+
+        if (count > 1 && depth < MAX_DEPTH) {
+            float invArea = 1.0f / box.area();
+            float rightArea[SWEEP_MAX];
+            for (int axis = 0; axis < 3; axis++) {
+                if (centroids.pmax[axis] <= centroids.pmin[axis]) continue;
+                std::sort(refs + begin, refs + end, CentroidLess(axis));
+
+                AABB right;
+                for (int i = end - 1; i > begin; i--) {
+                    right.grow(refs[i].box);
+                    rightArea[i - begin] = right.area();
+                }
+
+                AABB left;
+                for (int i = begin + 1; i < end; i++) {
+                    left.grow(refs[i - 1].box);
+                    float cost = 0.125f + (left.area() * (i - begin) + rightArea[i - begin] * (end - i)) * invArea;
+                    if (cost < bestCost) {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestSplit = i;
+                    }
+                }
+            }
+        }
+
+        if (bestAxis < 0 && count > MAX_LEAF_SIZE)
+            return medianSplit(refs, begin, end, centroids);
+        if (bestAxis < 0 || (bestCost >= leafCost && count <= MAX_LEAF_SIZE))
+            return -1;
+
+        if (bestAxis != 2)
+            std::sort(refs + begin, refs + end, CentroidLess(bestAxis));
+        return bestSplit;
+    }
+
+    // Egybeeso kozeppontok vagy tul mely fa: median vagas a kozeppontok leghosszabb tengelye menten
+    static int medianSplit(BVHPrimitive *refs, int begin, int end, const AABB &centroids) {
+        float ex = centroids.pmax.x - centroids.pmin.x, ey = centroids.pmax.y - centroids.pmin.y;
+        float ez = centroids.pmax.z - centroids.pmin.z;
+        int axis = ex >= ey && ex >= ez ? 0 : (ey >= ez ? 1 : 2);
+        int mid = begin + (end - begin) / 2;
+        std::nth_element(refs + begin, refs + mid, refs + end, CentroidLess(axis));
+        return mid;
+    }
+
+    // Egyszalu reszfa-epites az out tombbe; n a kovetkezo szabad csucs indexe
+    int buildSubtree(BVHPrimitive *refs, int begin, int end, int depth, BVHNode *out, int &n) {
+        int index = n++;
+        AABB box;
+        int mid = split(refs, begin, end, depth, 1, box);
+        out[index].box = box;
+        if (mid < 0) {
+            makeLeaf(out[index], refs, begin, end);
+            return index;
+        }
+
+        out[index].count = out[index].sphereFirst = out[index].sphereCount = 0;
+        buildSubtree(refs, begin, mid, depth + 1, out, n);
+        int right = buildSubtree(refs, mid, end, depth + 1, out, n);
+        out[index].offset = right;
+        return index;
+    }
+
+    // A fa felso szintjei: a taskSize-nal nagyobb csucsokat itt vagjuk (a vodroket tobb szal tolti), a kisebbekbol
+    // reszfa-feladat lesz; a feladat helyet a top tombben egy negativ count (-1 - feladat indexe) jeloli
+    void buildTop(BVHPrimitive *refs, int begin, int end, int depth, int threads, int taskSize,
+                  std::vector<BVHNode> &top, std::vector<Subtree> &tasks) {
+        int index = (int) top.size();
+        top.push_back(BVHNode());
+        if (end - begin <= taskSize) {
+            Subtree task = {begin, end, depth, NULL, 0};
+            top[index].count = -1 - (int) tasks.size();
+            tasks.push_back(task);
+            return;
+        }
+
+        AABB box;
+        int mid = split(refs, begin, end, depth, threads, box);
+        top[index].box = box;
+        if (mid < 0) {
+            makeLeaf(top[index], refs, begin, end);
+            return;
+        }
+
+        top[index].count = top[index].sphereFirst = top[index].sphereCount = 0;
+        buildTop(refs, begin, mid, depth + 1, threads, taskSize, top, tasks);
+        int right = (int) top.size();
+        buildTop(refs, mid, end, depth + 1, threads, taskSize, top, tasks);
+        top[index].offset = right;
+    }
+
+    // A felso szintek es a reszfak osszefuzese a vegleges, melysegi sorrendu tombbe
+    void emit(std::vector<BVHNode> &top, std::vector<Subtree> &tasks, int t) {
+        BVHNode src = top[t];
+        if (src.count < 0) {
+            Subtree &task = tasks[-1 - src.count];
+            int base = nodeCount;
+            for (int i = 0; i < task.nodeCount; i++) {
+                BVHNode &node = nodes[nodeCount++] = task.nodes[i];
+                if (node.count == 0)
+                    node.offset += base;
+            }
+            return;
+        }
+
+        int index = nodeCount++;
+        nodes[index] = src;
+        if (src.count > 0)
+            return;
+        emit(top, tasks, t + 1);
+        nodes[index].offset = nodeCount;
+        emit(top, tasks, src.offset);
+    }
+
+    // A felso szintek vagasa utan a reszfak feladatkent, tobb szalon epulnek, vegul egy tombbe fuzodnek
+    void buildBinned(BVHPrimitive *refs, Arena &arena, int threads) {
+        // Szalankent legalabb nehany feladat, hogy a kulonbozo meretu reszfak kiegyenlitodjenek
+        int taskSize = threads > 1 ? std::max((int) PARALLEL_MIN, primCount / (threads * 8)) : primCount;
+        std::vector<BVHNode> top;
+        std::vector<Subtree> tasks;
+        buildTop(refs, 0, primCount, 0, threads, taskSize, top, tasks);
+
+        // Nagyobb feladatok elore; a szalak a kovetkezo feladatot egy kozos szamlalobol veszik
+        std::vector<int> order(tasks.size());
+        for (size_t i = 0; i < tasks.size(); i++)
+            order[i] = (int) i;
+        std::sort(order.begin(), order.end(), [&](int a, int b) {
+            return tasks[a].end - tasks[a].begin > tasks[b].end - tasks[b].begin;
+        });
+
+        Arena *threadArenas = new Arena[threads];
+        std::atomic<int> next(0);
+        auto work = [&](int worker) {
+            for (int i = next++; i < (int) order.size(); i = next++) {
+                Subtree &task = tasks[order[i]];
+                task.nodes = threadArenas[worker].allocate<BVHNode>(2 * (task.end - task.begin) - 1);
+                buildSubtree(refs, task.begin, task.end, task.depth, task.nodes, task.nodeCount);
+            }
+        };
+        std::vector<std::thread> workers;
+        for (int t = 1; t < std::min(threads, (int) tasks.size()); t++)
+            workers.emplace_back(work, t);
+        work(0);
+        for (size_t t = 0; t < workers.size(); t++)
+            workers[t].join();
+
+        int total = (int) top.size() - (int) tasks.size();
+        for (size_t i = 0; i < tasks.size(); i++)
+            total += tasks[i].nodeCount;
+        nodes = arena.allocate<BVHNode>(total);
+        emit(top, tasks, 0);
+        delete[] threadArenas;
+    }
+
+    //--- LBVH ---
+
+    struct MortonPrimitive {
+        uint64_t code;
+        int index;    // a refs tombben
+    };
+
+    // Az LBVH koztes faja: 0..n-2 a belso csucsok (a gyoker a 0.), n-1..2n-2 a levelek, a kodok sorrendjeben.
+    // Egy primitiv jut egy levelre; a cost a reszfa (nem normalt) SAH koltsege.
+    struct LinearNode {
+        AABB box;
+        float cost;
+        int left, right, parent;
+        int leaves;
+    };
+
+    static const int TREELET_SIZE = 7;
+
+    // ...cba -> ...c00b00a: a harom tengely bitjei felvaltva kovetik egymast
+    static uint64_t spreadBits(uint64_t x) {
+        x &= 0x1fffff;
+        x = (x | x << 32) & 0x1f00000000ffffULL;
+        x = (x | x << 16) & 0x1f0000ff0000ffULL;
+        x = (x | x << 8) & 0x100f00f00f00f00fULL;
+        x = (x | x << 4) & 0x10c30c30c30c30c3ULL;
+        x = (x | x << 2) & 0x1249249249249249ULL;
+        return x;
+    }
+
+    // x != 0
+    static int leadingZeros(uint64_t x) {
+#if defined(__GNUC__)
+        return __builtin_clzll(x);
+#else
+        int n = 0;
+        for (; !(x & 0x8000000000000000ULL); x <<= 1)
+            n++;
+        return n;
+#endif
+    }
+
+    static int bitIndex(int singleBit) {
+        return 63 - leadingZeros((uint64_t) singleBit);
+    }
+
+    // LSD radix rendezes 8 bites szamjegyenkent; minden szal a sajat darabjat szamolja meg es szorja szet, a darabok
+    // sorrendje rogzitett, igy a rendezes stabil, es az eredmenye a szalak szamatol fuggetlen
+    static void radixSort(std::vector<MortonPrimitive> &keys, int bits, int threads) {
+        int n = (int) keys.size();
+        std::vector<MortonPrimitive> temp(n);
+        std::vector<int> counts(threads * 256);
+
+        for (int shift = 0; shift < bits; shift += 8) {
+            std::fill(counts.begin(), counts.end(), 0);
+            parallelChunks(0, n, threads, [&](int t, int from, int to) {
+                int *c = &counts[t * 256];
+                for (int i = from; i < to; i++)
+                    c[(keys[i].code >> shift) & 255]++;
+            });
+
+            int sum = 0;
+            for (int d = 0; d < 256; d++) {
+                for (int t = 0; t < threads; t++) {
+                    int c = counts[t * 256 + d];
+                    counts[t * 256 + d] = sum;
+                    sum += c;
+                }
+            }
+
+            parallelChunks(0, n, threads, [&](int t, int from, int to) {
+                int *c = &counts[t * 256];
+                for (int i = from; i < to; i++)
+                    temp[c[(keys[i].code >> shift) & 255]++] = keys[i];
+            });
+            keys.swap(temp);
+        }
+    }
+
+    // Az i. es j. rendezett kod kozos prefixenek hossza, a tartomanyon kivul -1; egyezo kodoknal az indexek dontenek
+    static int commonPrefix(const MortonPrimitive *m, int n, int i, int j) {
+        if (j < 0 || j >= n)
+            return -1;
+        uint64_t x = m[i].code ^ m[j].code;
+        return x != 0 ? leadingZeros(x) : 64 + leadingZeros((uint64_t) (i ^ j));
+    }
+
+    // Karras: az i. belso csucs egyik vege az i. kod, a masikat es a vagast (az elso eltero bitet) binaris keresessel
+    // talaljuk meg, a tobbi csucstol fuggetlenul, igy a csucsok parhuzamosan szamolhatok
+    static void linearNode(const MortonPrimitive *m, int n, int i, LinearNode *tree) {
+        int d = commonPrefix(m, n, i, i + 1) > commonPrefix(m, n, i, i - 1) ? 1 : -1;
+        int minPrefix = commonPrefix(m, n, i, i - d);
+
+        int lmax = 2;
+        while (commonPrefix(m, n, i, i + lmax * d) > minPrefix)
+            lmax *= 2;
+        int l = 0;
+        for (int t = lmax / 2; t >= 1; t /= 2) {
+            if (commonPrefix(m, n, i, i + (l + t) * d) > minPrefix)
+                l += t;
+        }
+        int j = i + l * d;
+
+        int nodePrefix = commonPrefix(m, n, i, j);
+        int s = 0;
+        for (int div = 2; ; div *= 2) {
+            int t = (l + div - 1) / div;
+            if (commonPrefix(m, n, i, i + (s + t) * d) > nodePrefix)
+                s += t;
+            if (t == 1) break;
+        }
+        int split = i + s * d + std::min(d, 0);
+
+        LinearNode &node = tree[i];
+        node.left = std::min(i, j) == split ? n - 1 + split : split;
+        node.right = std::max(i, j) == split + 1 ? n - 1 + split + 1 : split + 1;
+        tree[node.left].parent = i;
+        tree[node.right].parent = i;
+    }
+
+    // Minden levelbol felfele indulunk; egy belso csucsot a masodikkent odaero szal dolgoz fel, amikor mar mindket
+    // reszfaja kesz. visit(i) csak az i alatti reszfat valtoztathatja, igy az eredmeny nem fugg az utemezestol.
+    template<class F>
+    static void bottomUp(LinearNode *tree, int n, int threads, F visit) {
+        std::vector<std::atomic<int>> arrivals(n > 1 ? n - 1 : 1);
+        for (size_t i = 0; i < arrivals.size(); i++)
+            arrivals[i] = 0;
+
+        parallelChunks(0, n, threads, [&](int, int from, int to) {
+            for (int k = from; k < to; k++) {
+                int i = tree[n - 1 + k].parent;
+                while (i >= 0 && arrivals[i].fetch_add(1) == 1) {
+                    visit(i);
+                    i = tree[i].parent;
+                }
+            }
+        });
+    }
+
+    static void joinChildren(LinearNode *tree, int i) {
+        LinearNode &node = tree[i], &l = tree[node.left], &r = tree[node.right];
+        node.box = l.box;
+        node.box.grow(r.box);
+        node.leaves = l.leaves + r.leaves;
+        node.cost = 0.125f * node.box.area() + l.cost + r.cost;
+    }
+
+    // Karras-Aila: a csucs alatt a legnagyobb feluletu belso csucsokat kibontva kapott, TREELET_SIZE levelu reszfat
+    // a leveleinek minden reszhalmazara szamolt legjobb ketteosztassal (dinamikus programozas) a legkisebb SAH
+    // koltsegure rendezzuk at; a belso csucsok ujrahasznalodnak, a levelek alatti reszfak nem valtoznak
+    static void optimizeTreelet(LinearNode *tree, int n, int root) {
+        int leaves[TREELET_SIZE], internals[TREELET_SIZE - 1];
+        int leafCount = 2, internalCount = 1;
+        leaves[0] = tree[root].left;
+        leaves[1] = tree[root].right;
+        internals[0] = root;
+        while (leafCount < TREELET_SIZE) {
+            int best = -1;
+            float bestArea = -1.0f;
+            for (int k = 0; k < leafCount; k++) {
+                if (leaves[k] < n - 1 && tree[leaves[k]].box.area() > bestArea) {
+                    bestArea = tree[leaves[k]].box.area();
+                    best = k;
+                }
+            }
+            if (best < 0) break;
+            int node = leaves[best];
+            internals[internalCount++] = node;
+            leaves[best] = tree[node].left;
+            leaves[leafCount++] = tree[node].right;
+        }
+
+        // A ketteosztasokbol eleg azokat nezni, amelyekben a legalacsonyabb bit a bal oldalra kerul
+        AABB boxes[1 << TREELET_SIZE];
+        float cost[1 << TREELET_SIZE];
+        unsigned char split[1 << TREELET_SIZE];
+        int full = (1 << leafCount) - 1;
+        for (int s = 1; s <= full; s++) {
+            int low = s & -s;
+            LinearNode &leaf = tree[leaves[bitIndex(low)]];
+            if (s == low) {
+                boxes[s] = leaf.box;
+                cost[s] = leaf.cost;
+                continue;
+            }
+
+            boxes[s] = boxes[s ^ low];
+            boxes[s].grow(leaf.box);
+            float best = FLOAT_MAX;
+            for (int p = (s - 1) & s; p > 0; p = (p - 1) & s) {
+                if (!(p & low)) continue;
+                float c = cost[p] + cost[s ^ p];
+                if (c < best) {
+                    best = c;
+                    split[s] = (unsigned char) p;
+                }
+            }
+            cost[s] = 0.125f * boxes[s].area() + best;
+        }
+
+        if (cost[full] >= tree[root].cost)
+            return;
+        int next = 1;
+        assignTreelet(tree, root, full, leaves, internals, next, split);
+    }
+
+    static void assignTreelet(LinearNode *tree, int node, int s, const int *leaves, const int *internals, int &next,
+                              const unsigned char *split) {
+        int parts[2] = {split[s], s ^ split[s]};
+        int children[2];
+        for (int c = 0; c < 2; c++) {
+            if ((parts[c] & (parts[c] - 1)) == 0) {
+                children[c] = leaves[bitIndex(parts[c])];
+            } else {
+                children[c] = internals[next++];
+                assignTreelet(tree, children[c], parts[c], leaves, internals, next, split);
+            }
+            tree[children[c]].parent = node;
+        }
+        tree[node].left = children[0];
+        tree[node].right = children[1];
+        joinChildren(tree, node);
+    }
+
+    // A koztes fa kiirasa melysegi sorrendben: a bal gyerek a kovetkezo csucs, a jobb a bal reszfa 2 * levelek - 1
+    // csucsa utan jon. false, ha a fa melyebb, mint amit a bejaras verme elbir.
+    bool emitLinear(const std::vector<LinearNode> &tree, const std::vector<MortonPrimitive> &morton, BVHPrimitive *refs) {
+        struct Item {
+            int node, pos, firstPrim, depth;
+        };
+        int n = primCount;
+        std::vector<Item> stack;
+        Item root = {0, 0, 0, 0};
+        stack.push_back(root);
+
+        while (!stack.empty()) {
+            Item item = stack.back();
+            stack.pop_back();
+            const LinearNode &x = tree[item.node];
+            BVHNode &out = nodes[item.pos];
+            out.box = x.box;
+            out.sphereFirst = 0;
+
+            if (item.node >= n - 1) {
+                BVHPrimitive &p = refs[morton[item.node - (n - 1)].index];
+                out.offset = item.firstPrim;
+                out.count = 1;
+                out.sphereCount = IsSphere()(p) ? 1 : 0;
+                prims[item.firstPrim] = p.object;
+                continue;
+            }
+
+            if (item.depth + 1 >= STACK_SIZE - 1)
+                return false;
+            int leftLeaves = tree[x.left].leaves;
+            out.count = out.sphereCount = 0;
+            out.offset = item.pos + 2 * leftLeaves;
+            Item right = {x.right, out.offset, item.firstPrim + leftLeaves, item.depth + 1};
+            Item left = {x.left, item.pos + 1, item.firstPrim, item.depth + 1};
+            stack.push_back(right);
+            stack.push_back(left);
+        }
+        nodeCount = 2 * n - 1;
+        return true;
+    }
+
+    // Kozeppontok doboza, Morton-kodok, rendezes, Karras-fa, dobozok alulrol felfele, treeletek, kiiras; a kiiras
+    // kivetelevel minden lepes tobb szalon fut
+    bool buildLinear(BVHPrimitive *refs, Arena &arena, int threads, const BVHBuildOptions &options) {
+        int n = primCount;
+        std::vector<AABB> parts(threads);
+        parallelChunks(0, n, threads, [&](int t, int from, int to) {
+            for (int i = from; i < to; i++)
+                parts[t].grow(refs[i].centroid);
+        });
+        AABB centroids;
+        for (int t = 0; t < threads; t++) {
+            if (!parts[t].empty())
+                centroids.grow(parts[t]);
+        }
+
+        int bitsPerAxis = options.mortonBits <= 30 ? 10 : 21;
+        float cells = (float) (1 << bitsPerAxis);
+        float scale[3];
+        for (int a = 0; a < 3; a++) {
+            float extent = centroids.pmax[a] - centroids.pmin[a];
+            scale[a] = extent > 0.0f ? cells / extent : 0.0f;
+        }
+
+        std::vector<MortonPrimitive> morton(n);
+        parallelChunks(0, n, threads, [&](int, int from, int to) {
+            for (int i = from; i < to; i++) {
+                uint64_t code = 0;
+                for (int a = 0; a < 3; a++) {
+                    float c = (refs[i].centroid[a] - centroids.pmin[a]) * scale[a];
+                    uint64_t cell = c <= 0.0f ? 0 : (c >= cells - 1.0f ? (uint64_t) cells - 1 : (uint64_t) c);
+                    code |= spreadBits(cell) << (2 - a);
+                }
+                morton[i].code = code;
+                morton[i].index = i;
+            }
+        });
+        radixSort(morton, 3 * bitsPerAxis, threads);
+
+        std::vector<LinearNode> tree(2 * n - 1);
+        LinearNode *t = &tree[0];
+        t[0].parent = -1;
+        parallelChunks(0, n, threads, [&](int, int from, int to) {
+            for (int k = from; k < to; k++) {
+                LinearNode &leaf = t[n - 1 + k];
+                leaf.box = refs[morton[k].index].box;
+                leaf.cost = leaf.box.area();
+                leaf.leaves = 1;
+                leaf.left = leaf.right = -1;
+            }
+        });
+        parallelChunks(0, n - 1, threads, [&](int, int from, int to) {
+            for (int i = from; i < to; i++)
+                linearNode(&morton[0], n, i, t);
+        });
+
+        bottomUp(t, n, threads, [&](int i) {
+            joinChildren(t, i);
+        });
+        for (int round = 0; round < options.treeletRounds; round++) {
+            bottomUp(t, n, threads, [&](int i) {
+                if (t[i].leaves >= TREELET_SIZE)
+                    optimizeTreelet(t, n, i);
+            });
+        }
+
+        nodes = arena.allocate<BVHNode>(2 * n - 1);
+        return emitLinear(tree, morton, refs);
+    }
+
+    // A level gombjai kerulnek elore, ezek SIMD blokkba is bekerulnek, a tobbi primitivet egyenkent metszuk.
+    // A SphereSet-be a levelek csak az osszefuzes utan, a csucsok sorrendjeben kerulnek (finishLeaves).
+    void makeLeaf(BVHNode &node, BVHPrimitive *refs, int begin, int end) {
+        BVHPrimitive *split = std::stable_partition(refs + begin, refs + end, IsSphere());
+
+        node.offset = begin;
+        node.count = end - begin;
+        node.sphereFirst = 0;
+        node.sphereCount = (int) (split - (refs + begin));
+        for (int i = begin; i < end; i++)
+            prims[i] = refs[i].object;
+    }
+
+    void finishLeaves() {
+        int lanes = 0;
+        for (int i = 0; i < nodeCount; i++)
+            lanes += nodes[i].count > 0 ? (nodes[i].sphereCount + SPHERE_LANES - 1) / SPHERE_LANES * SPHERE_LANES : 0;
+        spheres.reserve(lanes);
+
+        float rootArea = nodes[0].box.area();
+        stats.nodes = nodeCount;
+        stats.leaves = 0;
+        stats.sahCost = 0.0f;
+
+        for (int i = 0; i < nodeCount; i++) {
+            BVHNode &node = nodes[i];
+            float weight = rootArea > 0.0f ? node.box.area() / rootArea : 1.0f;
+            if (node.count == 0) {
+                stats.sahCost += 0.125f * weight;
+                continue;
+            }
+
+            stats.leaves++;
+            stats.sahCost += node.count * weight;
+            node.sphereFirst = spheres.size();
+            for (int j = node.offset; j < node.offset + node.sphereCount; j++) {
+                Point center;
+                float r;
+                if (store->getSphere(prims[j], center, r))
+                    spheres.push(center, r, prims[j]);
+            }
+            spheres.pad();
+        }
+
+        sahArea = 0.0;
+        for (int i = 0; i < nodeCount; i++)
+            sahArea += sahWeight(nodes[i]);
+        builtCost = sahCost();
+    }
+
+    //--- Szeles csucsok ---
+
+    // A csucs kvantuma akkora, hogy a legfelso racspont se essen a doboza ala; gyerekenkent a legszukebb, a gyerek
+    // dobozat tartalmazo racsintervallum
+    template<int W, class Q>
+    void quantize(WideNode<W, Q> &w, const WideNode<W, Q> *all) {
+        const int QMAX = std::numeric_limits<Q>::max();
+        const AABB &frame = nodes[w.binary].box;
+        for (int a = 0; a < 3; a++) {
+            float origin = frame.pmin[a], scale = (frame.pmax[a] - frame.pmin[a]) / QMAX;
+            float grow = maxf(scale * 1e-6f, std::numeric_limits<float>::min());
+            while (scale > 0.0f && origin + QMAX * scale < frame.pmax[a]) {
+                scale += grow;
+                grow *= 2.0f;
+            }
+            w.origin[a] = origin;
+            w.scale[a] = scale;
+        }
+
+        for (int i = 0; i < W; i++) {
+            bool used = (w.childMask >> i) & 1;
+            const AABB &box = !used ? frame : (w.leafMask >> i) & 1 ? nodes[w.child[i]].box : nodes[all[w.child[i]].binary].box;
+            for (int a = 0; a < 3; a++) {
+                float origin = w.origin[a], scale = w.scale[a];
+                int lo = 0, hi = 0;
+                if (used && scale > 0.0f) {
+                    lo = std::max(0, std::min(QMAX, (int) floorf((box.pmin[a] - origin) / scale)));
+                    hi = std::max(0, std::min(QMAX, (int) ceilf((box.pmax[a] - origin) / scale)));
+                    while (lo > 0 && origin + lo * scale > box.pmin[a])
+                        lo--;
+                    while (hi < QMAX && origin + hi * scale < box.pmax[a])
+                        hi++;
+                }
+                w.lo[a][i] = (Q) lo;
+                w.hi[a][i] = (Q) hi;
+            }
+        }
+    }
+
+    // Mohon osszevonas: a legnagyobb feluletu belso gyereket bontjuk ki, amig W gyerek nem lesz; a gyerekek szama
+    template<int W>
+    int expand(int binary, int *children) {
+        int n = 0;
+        if (nodes[binary].count > 0) {
+            children[n++] = binary;    // csak a gyoker lehet level
+        } else {
+            children[n++] = binary + 1;
+            children[n++] = nodes[binary].offset;
+        }
+        while (n < W) {
+            int best = -1;
+            float bestArea = -1.0f;
+            for (int k = 0; k < n; k++) {
+                if (nodes[children[k]].count == 0 && nodes[children[k]].box.area() > bestArea) {
+                    bestArea = nodes[children[k]].box.area();
+                    best = k;
+                }
+            }
+            if (best < 0) break;
+            int c = children[best];
+            children[best] = c + 1;
+            children[n++] = nodes[c].offset;
+        }
+        return n;
+    }
+
+    // Ennyi szeles csucs lesz a binaris reszfabol; a bontas a fa felso szintjein W-1 belso csucsot von ossze, az also
+    // szinteken kevesebbet, ezert elore meg kell szamolni
+    template<int W>
+    int countWide(int binary) {
+        int children[W], n = expand<W>(binary, children), count = 1;
+        for (int k = 0; k < n; k++) {
+            if (nodes[children[k]].count == 0)
+                count += countWide<W>(children[k]);
+        }
+        return count;
+    }
+
+    // A szeles csucsok melysegi sorrendben kerulnek az all tombbe
+    template<int W, class Q>
+    int collapse(int binary, WideNode<W, Q> *all, int &count) {
+        int index = count++;
+        int children[W], n = expand<W>(binary, children);
+
+        WideNode<W, Q> &w = all[index];
+        w.binary = binary;
+        w.childMask = (unsigned char) ((1 << n) - 1);
+        w.leafMask = 0;
+        for (int k = 0; k < W; k++) {
+            if (k >= n) {
+                w.child[k] = -1;
+            } else if (nodes[children[k]].count > 0) {
+                w.child[k] = children[k];
+                w.leafMask |= 1 << k;
+            } else {
+                w.child[k] = collapse(children[k], all, count);
+            }
+        }
+        quantize(w, all);
+        return index;
+    }
+
+    template<int W, class Q>
+    void buildWide(Arena &arena) {
+        WideNode<W, Q> *all = arena.allocate<WideNode<W, Q>>(countWide<W>(0));
+        wideCount = 0;
+        collapse(0, all, wideCount);
+        wide = all;
+        if (parents != NULL) {
+            wideOf = arena.allocate<int>(nodeCount);
+            std::fill(wideOf, wideOf + nodeCount, -1);
+            for (int i = 0; i < wideCount; i++)
+                wideOf[all[i].binary] = i;
+        }
+        stats.wideNodes = wideCount;
+        stats.wideNodeBytes = (int) sizeof(WideNode<W, Q>);
+    }
+
+    // changed == NULL eseten minden szeles csucs, kulonben azok, amik a changed binaris csucsokbol lettek
+    template<int W, class Q>
+    void requantize(const int *changed, int count) {
+        WideNode<W, Q> *all = static_cast<WideNode<W, Q> *>(wide);
+        if (changed == NULL) {
+            for (int i = 0; i < wideCount; i++)
+                quantize(all[i], all);
+            return;
+        }
+        for (int i = 0; i < count; i++) {
+            if (wideOf[changed[i]] >= 0)
+                quantize(all[wideOf[changed[i]]], all);
+        }
+    }
+
+    void requantizeWide(const int *changed, int count) {
+        if (wide == NULL) return;
+        if (wideWidth == 8 && wideBits == 8) requantize<8, uint8_t>(changed, count);
+        else if (wideWidth == 8) requantize<8, uint16_t>(changed, count);
+        else if (wideBits == 8) requantize<4, uint8_t>(changed, count);
+        else requantize<4, uint16_t>(changed, count);
+    }
+
+    bool intersectLeaf(const BVHNode &node, Ray &ray, float &t, ObjectHandle &o) {
+        bool intersected = false;
+        float t_temp;
+        RAY_STAT_ADD(intersectionTests, node.count);
+        if (node.sphereCount > 0 && spheres.intersect(node.sphereFirst, node.sphereCount, ray, RAY_EPSILON, t, o))
+            intersected = true;
+        for (int i = node.offset + node.sphereCount; i < node.offset + node.count; i++) {
+            if (store->intersect(prims[i], ray, t_temp) && t_temp > RAY_EPSILON && t_temp < t) {
+                t = t_temp;
+                o = prims[i];
+                intersected = true;
+            }
+        }
+        return intersected;
+    }
+
+    bool occludedLeaf(const BVHNode &node, Ray &ray, float tmin, float tmax) {
+        float t;
+        RAY_STAT_ADD(intersectionTests, node.sphereCount);
+        if (node.sphereCount > 0 && spheres.occluded(node.sphereFirst, node.sphereCount, ray, tmin, tmax))
+            return true;
+        for (int i = node.offset + node.sphereCount; i < node.offset + node.count; i++) {
+            RAY_STAT(intersectionTests);
+            if (store->intersect(prims[i], ray, t) && t > tmin && t < tmax)
+                return true;
+        }
+        return false;
+    }
+
+    // A talalt gyerekek tavolsag szerint csokkeno sorrendben kerulnek a verembe, igy a legkozelebbi jon elobb;
+    // a levelet a binaris level indexenek komplementere jeloli
+    template<int W, class Q>
+    bool intersectWide(Ray &ray, float &t, ObjectHandle &o) {
+        const WideNode<W, Q> *all = static_cast<const WideNode<W, Q> *>(wide);
+        WideRay r(ray);
+        int stack[WIDE_STACK];
+        float stackNear[WIDE_STACK];
+        int sp = 0;
+        stack[sp] = 0;
+        stackNear[sp++] = -FLOAT_MAX;
+        bool intersected = false;
+
+        while (sp > 0) {
+            sp--;
+            if (stackNear[sp] >= t) continue;
+            int index = stack[sp];
+            if (index < 0) {
+                if (intersectLeaf(nodes[~index], ray, t, o))
+                    intersected = true;
+                continue;
+            }
+
+            const WideNode<W, Q> &node = all[index];
+            alignas(32) float tnear[W];
+            int first = sp;
+            for (int hits = slabTest(node, r, RAY_EPSILON, t, tnear); hits != 0; hits &= hits - 1) {
+                int i = bitIndex(hits & -hits);
+                int entry = (node.leafMask >> i) & 1 ? ~node.child[i] : node.child[i];
+                int j = sp++;
+                for (; j > first && stackNear[j - 1] < tnear[i]; j--) {
+                    stack[j] = stack[j - 1];
+                    stackNear[j] = stackNear[j - 1];
+                }
+                stack[j] = entry;
+                stackNear[j] = tnear[i];
+            }
+        }
+        return intersected;
+    }
+
+    template<int W, class Q>
+    bool occludedWide(Ray &ray, float tmin, float tmax) {
+        const WideNode<W, Q> *all = static_cast<const WideNode<W, Q> *>(wide);
+        WideRay r(ray);
+        int stack[WIDE_STACK];
+        int sp = 0;
+        stack[sp++] = 0;
+
+        while (sp > 0) {
+            int index = stack[--sp];
+            if (index < 0) {
+                if (occludedLeaf(nodes[~index], ray, tmin, tmax))
+                    return true;
+                continue;
+            }
+
+            const WideNode<W, Q> &node = all[index];
+            alignas(32) float tnear[W];
+            for (int hits = slabTest(node, r, tmin, tmax, tnear); hits != 0; hits &= hits - 1) {
+                int i = bitIndex(hits & -hits);
+                stack[sp++] = (node.leafMask >> i) & 1 ? ~node.child[i] : node.child[i];
+            }
+        }
+        return false;
+    }
+
+    //--- Refit ---
+
+    // A csucs jaruleka a (nem normalt) SAH koltseghez, ugyanaz a sulyozas, mint a BVHBuildStats-ban
+    static double sahWeight(const BVHNode &node) {
+        return (node.count > 0 ? (double) node.count : 0.125) * node.box.area();
+    }
+
+    AABB refitBox(int i) {
+        BVHNode &node = nodes[i];
+        AABB box;
+        if (node.count > 0) {
+            for (int j = node.offset; j < node.offset + node.count; j++) {
+                AABB b;
+                if (store->getBounds(prims[j], b))
+                    box.grow(b);
+            }
+        } else {
+            box.grow(nodes[i + 1].box);
+            box.grow(nodes[node.offset].box);
+        }
+        return box;
+    }
+
+    // A reszfa a melysegi sorrend miatt folytonos: a legjobboldalibb levele utan er veget
+    int subtreeEnd(int i) {
+        while (nodes[i].count == 0)
+            i = nodes[i].offset;
+        return i + 1;
+    }
+
+    // A [begin, end) reszfa dobozai visszafele haladva (a gyerekek indexe nagyobb a szuloenel); a reszfa SAH osszege
+    double refitRange(int begin, int end) {
+        double area = 0.0;
+        for (int i = end - 1; i >= begin; i--) {
+            nodes[i].box = refitBox(i);
+            area += sahWeight(nodes[i]);
+        }
+        return area;
+    }
+
+    // A levelek a peldanyok (az egyetlen mozgathato objektumtipus) handle-jevel, es a szulok a reszleges refithez
+    void indexMovable(Arena &arena) {
+        for (int i = 0; i < primCount; i++)
+            movableCount += handleType(prims[i]) == OBJECT_INSTANCE;
+        if (movableCount == 0) return;
+
+        movable = arena.allocate<LeafRef>(movableCount);
+        parents = arena.allocate<int>(nodeCount);
+        dirty = arena.allocate<unsigned char>(nodeCount);
+        parents[0] = -1;
+        int k = 0;
+        for (int i = 0; i < nodeCount; i++) {
+            BVHNode &node = nodes[i];
+            if (node.count == 0) {
+                parents[i + 1] = parents[node.offset] = i;
+                continue;
+            }
+            for (int j = node.offset; j < node.offset + node.count; j++) {
+                if (handleType(prims[j]) == OBJECT_INSTANCE) {
+                    movable[k].object = prims[j];
+                    movable[k++].leaf = i;
+                }
+            }
+        }
+        std::sort(movable, movable + movableCount);
+    }
+
+    // A tombok a hivo arenajaban vannak, azokat az arena egyben szabaditja fel
+    void release() {
+        nodes = NULL;
+        prims = unbounded = NULL;
+        wide = NULL;
+        movable = NULL;
+        parents = wideOf = NULL;
+        dirty = NULL;
+        spheres.clear();
+        nodeCount = primCount = unboundedCount = wideCount = movableCount = 0;
+        wideWidth = 2;
+        sahArea = 0.0;
+        builtCost = 0.0f;
+    }
+
+    // Elobb a frustum teszt, ha az nem zarja ki, savonkenti slab teszt; tnear a legkozelebbi belepes
+    bool hitsBox(RayPacket &p, PacketFrustum &f, const AABB &box, float maxT, float &tnear) {
+        if (f.missesAll(box, maxT))
+            return false;
+
+        float nearest = FLOAT_MAX;
+        int any = 0;
+        for (int i = 0; i < PACKET_SIZE; i++) {
+            float tx1 = (box.pmin.x - p.ox[i]) * f.invx[i], tx2 = (box.pmax.x - p.ox[i]) * f.invx[i];
+            float ty1 = (box.pmin.y - p.oy[i]) * f.invy[i], ty2 = (box.pmax.y - p.oy[i]) * f.invy[i];
+            float tz1 = (box.pmin.z - p.oz[i]) * f.invz[i], tz2 = (box.pmax.z - p.oz[i]) * f.invz[i];
+
+            float t0 = maxf(maxf(minf(tx1, tx2), minf(ty1, ty2)), minf(tz1, tz2));
+            float t1 = minf(minf(maxf(tx1, tx2), maxf(ty1, ty2)), maxf(tz1, tz2)) * 1.0000004f;
+
+            int hit = p.active[i] & (t0 <= t1) & (t1 > RAY_EPSILON) & (t0 < p.t[i]);
+            any |= hit;
+            nearest = minf(nearest, hit ? t0 : FLOAT_MAX);
+        }
+        tnear = nearest;
+        return any != 0;
+    }
+
+    // Az aktiv savok kozul a legtavolabbi eddigi talalat, ennel messzebb levo csucsot mar nem kell bejarni
+    static float farthestHit(RayPacket &p) {
+        float maxT = -FLOAT_MAX;
+        for (int i = 0; i < PACKET_SIZE; i++)
+            maxT = maxf(maxT, p.active[i] ? p.t[i] : -FLOAT_MAX);
+        return maxT;
+    }
+
+public:
+    BVH() : store(NULL), nodes(NULL), nodeCount(0), prims(NULL), primCount(0), unbounded(NULL), unboundedCount(0),
+            wide(NULL), wideCount(0), wideWidth(2), wideBits(8), sahArea(0.0), builtCost(0.0f), movable(NULL),
+            movableCount(0), parents(NULL), wideOf(NULL), dirty(NULL) {
+    }
+
+    bool built() {
+        return nodes != NULL;
+    }
+
+    // A csucsok es a primitiv-tombok az arenaba kerulnek, egymas utan, a bejarasi (melysegi) sorrendben;
+    // az arenanak a BVH-nal tovabb kell elnie, ujraepites elott a hivo uritheti.
+    // Az eredmeny a szalak szamatol nem fugg.
+    void build(ObjectStore &objects, Arena &arena, const BVHBuildOptions &options = BVHBuildOptions()) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        release();
+        store = &objects;
+
+        int count = objects.size();
+        BVHPrimitive *refs = new BVHPrimitive[count > 0 ? count : 1];
+        std::vector<ObjectHandle> infinite;
+        for (int i = 0; i < count; i++) {
+            ObjectHandle h = objects.handle(i);
+            AABB box;
+            if (objects.getBounds(h, box)) {
+                refs[primCount].box = box;
+                refs[primCount].centroid = box.centroid();
+                refs[primCount].object = h;
+                primCount++;
+            } else {
+                infinite.push_back(h);
+            }
+        }
+
+        unboundedCount = (int) infinite.size();
+        unbounded = arena.allocate<ObjectHandle>(unboundedCount);
+        for (int i = 0; i < unboundedCount; i++)
+            unbounded[i] = infinite[i];
+
+        int threads = options.threads > 0 ? options.threads : (int) std::thread::hardware_concurrency();
+        if (threads <= 0 || primCount < 2 * PARALLEL_MIN)
+            threads = 1;
+
+        prims = arena.allocate<ObjectHandle>(primCount);
+        stats = BVHBuildStats();
+        stats.builder = options.builder;
+        stats.threads = threads;
+        stats.primitives = primCount;
+        if (primCount > 0) {
+            if (options.builder != BVH_LBVH || !buildLinear(refs, arena, threads, options)) {
+                stats.builder = BVH_BINNED_SAH;
+                buildBinned(refs, arena, threads);
+            }
+            finishLeaves();
+            indexMovable(arena);
+
+            if (options.width == 4 || options.width == 8) {
+                wideWidth = stats.width = options.width;
+                wideBits = options.quantizationBits == 16 ? 16 : 8;
+                if (wideWidth == 8 && wideBits == 8) buildWide<8, uint8_t>(arena);
+                else if (wideWidth == 8) buildWide<8, uint16_t>(arena);
+                else if (wideBits == 8) buildWide<4, uint8_t>(arena);
+                else buildWide<4, uint16_t>(arena);
+            }
+        }
+
+        delete[] refs;
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    const BVHBuildStats &buildStats() {
+        return stats;
+    }
+
+    // A teljes fa doboza; false, ha a fa ures, vagy vegtelen objektum is van benne
+    bool bounds(AABB &box) {
+        if (nodeCount == 0 || unboundedCount > 0)
+            return false;
+        box = nodes[0].box;
+        return true;
+    }
+
+    // Mozgo objektumok utan: a fa szerkezete marad, csak a dobozok frissulnek alulrol felfele. A fa felso reszet
+    // nagyjabol egyforma reszfakra bontjuk, ezeket a szalak egymastol fuggetlenul frissitik, a reszfak feletti
+    // nehany csucsot pedig utana egy szal. A levelek SphereSet-beli gombjei nem frissulnek, mozgatni csak peldanyt lehet.
+    void refit() {
+        if (nodeCount == 0) return;
+
+        int threads = stats.threads;
+        if (threads <= 1 || nodeCount < 2 * PARALLEL_MIN) {
+            sahArea = refitRange(0, nodeCount);
+            requantizeWide(NULL, 0);
+            return;
+        }
+
+        // A legnagyobb reszfat bontjuk, amig szalankent legalabb negy nem lesz; a felbontottak a reszfak felett maradnak
+        std::vector<int> roots(1, 0), top;
+        while ((int) roots.size() < 4 * threads) {
+            int largest = -1, size = 0;
+            for (size_t r = 0; r < roots.size(); r++) {
+                int n = subtreeEnd(roots[r]) - roots[r];
+                if (nodes[roots[r]].count == 0 && n > size) {
+                    size = n;
+                    largest = (int) r;
+                }
+            }
+            if (largest < 0) break;
+            int i = roots[largest];
+            top.push_back(i);
+            roots[largest] = i + 1;
+            roots.push_back(nodes[i].offset);
+        }
+
+        std::vector<double> areas(roots.size());
+        parallelChunks(0, (int) roots.size(), threads, [&](int, int from, int to) {
+            for (int r = from; r < to; r++)
+                areas[r] = refitRange(roots[r], subtreeEnd(roots[r]));
+        });
+
+        sahArea = 0.0;
+        for (size_t r = 0; r < roots.size(); r++)
+            sahArea += areas[r];
+        std::sort(top.begin(), top.end(), std::greater<int>());
+        for (size_t k = 0; k < top.size(); k++) {
+            nodes[top[k]].box = refitBox(top[k]);
+            sahArea += sahWeight(nodes[top[k]]);
+        }
+        requantizeWide(NULL, 0);
+    }
+
+    // Csak a mozgatott peldanyok levelei es azok ososei frissulnek, igy a koltseg a mozgatott objektumok szamaval
+    // (szorozva a fa melysegevel) aranyos; a SAH koltseg a valtozasokkal frissul. Ha a fa nagy resze mozdult, a teljes,
+    // parhuzamos refit olcsobb. A fa levelei kozott nem szereplo handle-ok (pl. vegtelen peldany) kimaradnak.
+    void refit(const ObjectHandle *moved, int count) {
+        if (movableCount == 0) return;
+        if (count > nodeCount / 16) {
+            refit();
+            return;
+        }
+
+        std::vector<int> changed;
+        for (int m = 0; m < count; m++) {
+            LeafRef key;
+            key.object = moved[m];
+            LeafRef *ref = std::lower_bound(movable, movable + movableCount, key);
+            if (ref == movable + movableCount || ref->object != moved[m]) continue;
+            for (int i = ref->leaf; i >= 0 && !dirty[i]; i = parents[i]) {
+                dirty[i] = 1;
+                changed.push_back(i);
+            }
+        }
+
+        std::sort(changed.begin(), changed.end(), std::greater<int>());
+        for (size_t k = 0; k < changed.size(); k++) {
+            int i = changed[k];
+            sahArea -= sahWeight(nodes[i]);
+            nodes[i].box = refitBox(i);
+            sahArea += sahWeight(nodes[i]);
+            dirty[i] = 0;
+        }
+        if (!changed.empty())
+            requantizeWide(&changed[0], (int) changed.size());
+    }
+
+    // Az aktualis SAH koltseg, ugyanugy normalva, mint BVHBuildStats::sahCost; refit utan altalaban no
+    float sahCost() {
+        float rootArea = nodeCount > 0 ? nodes[0].box.area() : 0.0f;
+        return rootArea > 0.0f ? (float) (sahArea / rootArea) : 0.0f;
+    }
+
+    // Hanyszorosa az aktualis SAH koltseg az epiteskorinak
+    float degradation() {
+        return builtCost > 0.0f ? sahCost() / builtCost : 1.0f;
+    }
+
+    // A legkozelebbi talalat; a normalist a hivo szamolja ki, egyszer, a vegso talalatra
+    bool intersect(Ray &ray, float &t, ObjectHandle &o) {
+        bool intersected = false;
+        float t_temp;
+
+        RAY_STAT_ADD(intersectionTests, unboundedCount);
+        for (int i = 0; i < unboundedCount; i++) {
+            if (store->intersect(unbounded[i], ray, t_temp) && t_temp > RAY_EPSILON && t_temp < t) {
+                t = t_temp;
+                o = unbounded[i];
+                intersected = true;
+            }
+        }
+
+        if (nodeCount == 0)
+            return intersected;
+        if (wide != NULL) {
+            bool hit = wideWidth == 8 ? (wideBits == 8 ? intersectWide<8, uint8_t>(ray, t, o) : intersectWide<8, uint16_t>(ray, t, o))
+                                      : (wideBits == 8 ? intersectWide<4, uint8_t>(ray, t, o) : intersectWide<4, uint16_t>(ray, t, o));
+            return hit || intersected;
+        }
+
+        Vector invDir = ray.v.inverse();
+        float tnear;
+        if (!nodes[0].box.intersect(ray.p0, invDir, RAY_EPSILON, t, tnear))
+            return intersected;
+
+        int stack[STACK_SIZE];
+        float stackNear[STACK_SIZE];
+        int sp = 0;
+        int index = 0;
+
+        while (true) {
+            BVHNode &node = nodes[index];
+
+            if (node.count > 0) {
+                if (intersectLeaf(node, ray, t, o))
+                    intersected = true;
+            } else {
+                int left = index + 1, right = node.offset;
+                float tl, tr;
+                bool hitLeft = nodes[left].box.intersect(ray.p0, invDir, RAY_EPSILON, t, tl);
+                bool hitRight = nodes[right].box.intersect(ray.p0, invDir, RAY_EPSILON, t, tr);
+
+                if (hitLeft && hitRight) {
+                    if (tr < tl) {
+                        std::swap(left, right);
+                        std::swap(tl, tr);
+                    }
+                    stack[sp] = right;
+                    stackNear[sp++] = tr;
+                    index = left;
+                    continue;
+                }
+                if (hitLeft) {
+                    index = left;
+                    continue;
+                }
+                if (hitRight) {
+                    index = right;
+                    continue;
+                }
+            }
+
+            // A veremben levo csucsok kozul atlepjuk azokat, amik mar a legkozelebbi talalat mogott vannak
+            do {
+                if (sp == 0)
+                    return intersected;
+                sp--;
+            } while (stackNear[sp] >= t);
+            index = stack[sp];
+        }
+    }
+
+    // Arnyeksugarakhoz: az elso (nem feltetlenul legkozelebbi) talalatnal visszater
+    bool occluded(Ray &ray, float tmin, float tmax) {
+        float t;
+
+        for (int i = 0; i < unboundedCount; i++) {
+            RAY_STAT(intersectionTests);
+            if (store->intersect(unbounded[i], ray, t) && t > tmin && t < tmax)
+                return true;
+        }
+
+        if (nodeCount == 0)
+            return false;
+        if (wide != NULL)
+            return wideWidth == 8 ? (wideBits == 8 ? occludedWide<8, uint8_t>(ray, tmin, tmax) : occludedWide<8, uint16_t>(ray, tmin, tmax))
+                                  : (wideBits == 8 ? occludedWide<4, uint8_t>(ray, tmin, tmax) : occludedWide<4, uint16_t>(ray, tmin, tmax));
+
+        Vector invDir = ray.v.inverse();
+        int stack[STACK_SIZE];
+        int sp = 0;
+        stack[sp++] = 0;
+
+        while (sp > 0) {
+            BVHNode &node = nodes[stack[--sp]];
+            float tnear;
+            if (!node.box.intersect(ray.p0, invDir, tmin, tmax, tnear))
+                continue;
+
+            if (node.count > 0) {
+                if (occludedLeaf(node, ray, tmin, tmax))
+                    return true;
+            } else {
+                stack[sp++] = node.offset;
+                stack[sp++] = (int) (&node - nodes) + 1;
+            }
+        }
+
+        return false;
+    }
+
+    // A csomag aktiv sugaraira frissiti a t es object mezoket
+    void intersect(RayPacket &packet) {
+        int lanes = 0;
+        for (int i = 0; i < PACKET_SIZE; i++)
+            lanes += packet.active[i] != 0;
+
+        RAY_STAT_ADD(intersectionTests, unboundedCount * lanes);
+        for (int i = 0; i < unboundedCount; i++)
+            store->intersectPacket(unbounded[i], packet);
+
+        if (nodeCount == 0)
+            return;
+
+        PacketFrustum frustum(packet);
+        float maxT = farthestHit(packet);
+        float tnear;
+        if (!hitsBox(packet, frustum, nodes[0].box, maxT, tnear))
+            return;
+
+        int stack[STACK_SIZE];
+        float stackNear[STACK_SIZE];
+        int sp = 0;
+        int index = 0;
+
+        while (true) {
+            BVHNode &node = nodes[index];
+
+            if (node.count > 0) {
+                RAY_STAT_ADD(intersectionTests, node.count * lanes);
+                for (int i = node.offset; i < node.offset + node.count; i++)
+                    store->intersectPacket(prims[i], packet);
+                maxT = farthestHit(packet);
+            } else {
+                int left = index + 1, right = node.offset;
+                float tl, tr;
+                bool hitLeft = hitsBox(packet, frustum, nodes[left].box, maxT, tl);
+                bool hitRight = hitsBox(packet, frustum, nodes[right].box, maxT, tr);
+
+                if (hitLeft && hitRight) {
+                    if (tr < tl) {
+                        std::swap(left, right);
+                        std::swap(tl, tr);
+                    }
+                    stack[sp] = right;
+                    stackNear[sp++] = tr;
+                    index = left;
+                    continue;
+                }
+                if (hitLeft) {
+                    index = left;
+                    continue;
+                }
+                if (hitRight) {
+                    index = right;
+                    continue;
+                }
+            }
+
+            // Ha a csomag minden sugara mar kozelebb talalt, a csucsot atlepjuk
+            do {
+                if (sp == 0)
+                    return;
+                sp--;
+            } while (stackNear[sp] >= maxT);
+            index = stack[sp];
+        }
+    }
+
+    ~BVH() {
+        release();
+    }
+};
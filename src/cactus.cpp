@@ -0,0 +1,194 @@
+//--------------------------------------------------------
+// Kaktusz
+//--------------------------------------------------------
+// A torzsbol a torzzsel hasonlo, de kisebb reszek nonek ki, mindig a feluletre merolegesen, tobb szinten at.
+// Minden resz ugyanannak az alapalaknak (ObjectStore::addShape) egy peldanya, igy resz-enkent csak egy
+// elforgatas, eltolas es skala tarolodik. A seed-bol a teljes hierarchia determinisztikusan kovetkezik.
+// A peldanyositott valtozatban (growModel) a reszfak is megosztottak, a memoria a szintek szamaval no.
+enum CactusKind {
+    CACTUS_ELLIPSOID,
+    CACTUS_PARABOLOID,    // a csucs felfele, a fedolap a talpon
+    CACTUS_CYLINDER
+};
+
+// Egy resz a vilagban: a talppontja, a novesi iranya (a szulo feluletenek normalisa) es a torzshoz mert skalaja
+struct CactusPart {
+    Point base;
+    Vector axis;
+    float scale;
+};
+
+class CactusGenerator {
+    CactusKind kind;
+    float r, h;              // a torzs sugara es magassaga
+    int branches;            // reszenkent ennyi kinoves
+    float childScale;        // a kinoves merete a szulohoz kepest
+    unsigned int seed;
+
+    // xorshift32, [0, 1)
+    float random() {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return (seed >> 8) * (1.0f / 16777216.0f);
+    }
+
+    // A resz feluletenek egy pontja es ott a kifele mutato normalis; u a tengely koruli szog, v a tengely menti
+    // helyzet a [0, 1) intervallumbol. A talp es a csucs kornyeket kihagyjuk, oda nem nohet ki ujabb resz.
+    void surfacePoint(CactusPart &part, float u, float v, Point &p, Vector &n) {
+        Vector e1, e2;
+        orthonormalFrame(part.axis, e1, e2);
+        float phi = 2.0f * (float) M_PI * u;
+        Vector radial = e1 * cosf(phi) + e2 * sinf(phi);
+        float rs = r * part.scale, hs = h * part.scale;
+
+        switch (kind) {
+            case CACTUS_ELLIPSOID: {
+                float a = hs * 0.5f, z = a * (-0.1f + 0.85f * v);
+                float rho = rs * sqrtf(maxf(0.0f, 1.0f - z * z / (a * a)));
+                p = part.base + part.axis * (a + z) + radial * rho;
+                n = (radial * (rho / (rs * rs)) + part.axis * (z / (a * a))).normalize();
+                break;
+            }
+            case CACTUS_PARABOLOID: {
+                // A csucstol t tavolsagra a sugar rs sqrt(t / hs); |radialis|^2 - k t gradiense
+                float t = hs * (0.1f + 0.6f * v), rho = rs * sqrtf(t / hs), k = rs * rs / hs;
+                p = part.base + part.axis * (hs - t) + radial * rho;
+                n = (radial * (2.0f * rho) + part.axis * k).normalize();
+                break;
+            }
+            default:
+                p = part.base + part.axis * (hs * (0.3f + 0.6f * v)) + radial * rs;
+                n = radial;
+                break;
+        }
+    }
+
+public:
+    CactusGenerator(CactusKind kind, float r, float h, int branches = 5, float childScale = 0.4f, unsigned int seed = 1)
+            : kind(kind), r(r), h(h), branches(branches), childScale(childScale), seed(seed != 0 ? seed : 1) {
+        if (branches < 1)
+            throw std::invalid_argument("CactusGenerator: a cactus needs at least one branch per part");
+    }
+
+    // A szintek teljesek: annyi szint (a torzzsel egyutt) lesz, amennyi 1 + b + b^2 + ... <= maxParts-ba belefer
+    int levelsFor(int maxParts, int &total) {
+        int levels = 1, levelParts = 1;
+        total = 1;
+        // levelParts * branches <= maxParts - total, osztassal, hogy a szorzat ne csordulhasson tul
+        while (levelParts <= (maxParts - total) / branches) {
+            levelParts *= branches;
+            total += levelParts;
+            levels++;
+        }
+        return levels;
+    }
+
+    // A torzs es a kinovesek szintenkent, annyi szint, amennyi maxParts-ba belefer.
+    // Az asztal (z = 0) ala nyulo kinovest es annak leszarmazottait elhagyjuk.
+    void grow(Point base, int maxParts, DynamicArray<CactusPart> &parts) {
+        int total;
+        levelsFor(maxParts, total);
+        parts.reserve(parts.size + total);
+
+        CactusPart trunk;
+        trunk.base = base;
+        trunk.axis = Vector(0.0f, 0.0f, 1.0f);
+        trunk.scale = 1.0f;
+        parts.push(trunk);
+
+        int levelStart = parts.size - 1, levelEnd = parts.size;
+        for (int size = 1; size < total; size = size * branches + 1) {
+            for (int i = levelStart; i < levelEnd; i++) {
+                // A szog szerint retegezve, hogy a kinovesek nagyjabol egyenletesen oszoljanak el a feluleten
+                for (int j = 0; j < branches; j++) {
+                    Point p;
+                    Vector n;
+                    surfacePoint(parts[i], (j + random()) / branches, random(), p, n);
+
+                    CactusPart child;
+                    child.scale = parts[i].scale * childScale;
+                    child.axis = n;
+                    child.base = p + n * (-1.0f * r * child.scale);    // a talp a szulobe sullyed, nem marad res
+                    float lowest = minf(child.base.z, child.base.z + n.z * h * child.scale) - r * child.scale;
+                    if (lowest > 0.0f)
+                        parts.push(child);
+                }
+            }
+            levelStart = levelEnd;
+            levelEnd = parts.size;
+        }
+    }
+
+    // Peldanyositott kaktusz: az also szinttol felfele szintenkent variants darab modell, mindegyik egy torzs es
+    // branches darab kinoves, ami az eggyel alacsonyabb szint egy veletlen modelljenek peldanya. A legfelso
+    // modellt adja vissza, a kirajzolt reszek szama ugyanannyi, mint a grow-nal, a tarolt objektumoke
+    // szintenkent variants * (branches + 1). A kinoveseket itt nem vagjuk az asztalhoz, a modell nem tudja,
+    // hova kerul.
+    Model *growModel(World &world, int maxParts, int variants = 4) {
+        int total, levels = levelsFor(maxParts, total);
+        CactusPart trunk;
+        trunk.axis = Vector(0.0f, 0.0f, 1.0f);
+        trunk.scale = 1.0f;
+
+        std::vector<Model *> lower, current;
+        for (int level = 0; level < levels; level++) {
+            int count = level == levels - 1 ? 1 : variants;
+            for (int v = 0; v < count; v++) {
+                Model *model = world.addModel();
+                int shape = addShape(model->objects);
+                model->objects.addPart(Model::MATERIAL, shape, trunk.base, trunk.axis, 1.0f);
+
+                for (int j = 0; level > 0 && j < branches; j++) {
+                    Point p;
+                    Vector n;
+                    surfacePoint(trunk, (j + random()) / branches, random(), p, n);
+                    Model *child = lower[(int) (random() * lower.size()) % lower.size()];
+                    model->objects.addInstance(Model::MATERIAL, child,
+                                               placementMatrix(p + n * (-1.0f * r * childScale), n, childScale));
+                }
+                world.buildModel(model);
+                current.push_back(model);
+            }
+            lower.swap(current);
+            current.clear();
+        }
+        return lower[0];
+    }
+
+    // A kaktusz alapalakja a sajat rendszereben: a talp az origoban, a tengely a z
+    int addShape(ObjectStore &objects) {
+        switch (kind) {
+            case CACTUS_ELLIPSOID: {
+                // x^2 / r^2 + y^2 / r^2 + (z - a)^2 / a^2 = 1
+                float a = h * 0.5f;
+                QMatrix Q;
+                Q.m[0][0] = Q.m[1][1] = 1.0f / (r * r);
+                Q.m[2][2] = 1.0f / (a * a);
+                Q.m[2][3] = Q.m[3][2] = -1.0f / a;
+                return objects.addShape(Q);
+            }
+            case CACTUS_PARABOLOID:
+                return objects.addShape(makeParaboloid(Point(0.0f, 0.0f, h), Vector(0.0f, 0.0f, -1.0f), r, h));
+            default:
+                return objects.addShape(makeCylinder(Point(0.0f, 0.0f, 0.0f), Vector(0.0f, 0.0f, 1.0f), r, h));
+        }
+    }
+};
+
+// Legfeljebb maxParts reszbol allo kaktusz a base talpponttal; a reszek szama a visszateresi ertek
+int addCactus(ObjectStore &objects, MaterialIndex material, CactusGenerator &generator, Point base, int maxParts) {
+    DynamicArray<CactusPart> parts;
+    generator.grow(base, maxParts, parts);
+
+    int shape = generator.addShape(objects);
+    for (int i = 0; i < parts.size; i++)
+        objects.addPart(material, shape, parts[i].base, parts[i].axis, parts[i].scale);
+    return parts.size;
+}
+
+// Mint az addCactus, de a reszfak megosztott modellek peldanyai (CactusGenerator::growModel)
+ObjectHandle addInstancedCactus(World &world, MaterialIndex material, CactusGenerator &generator, Point base, int maxParts) {
+    Model *model = generator.growModel(world, maxParts);
+    return world.objects.addInstance(material, model, placementMatrix(base, Vector(0.0f, 0.0f, 1.0f), 1.0f));
+}
@@ -0,0 +1,104 @@
+#include <stddef.h>
+#include <algorithm>
+
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32__)
+#include <malloc.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+//--------------------------------------------------------
+// Framebuffer
+//--------------------------------------------------------
+// Futasidoben meretezett kep. A memoriat csak az elso data() hivas foglalja le (render elott, a fo szalon),
+// cache-sorhoz, nagy kepnel huge page-hez igazitva, es release()-ig vagy a destruktorig tartja meg.
+class Framebuffer {
+    static const size_t CACHE_LINE = 64;
+    static const size_t HUGE_PAGE = 2 * 1024 * 1024;
+
+    unsigned int width, height;
+    Color *pixels;
+
+    static void *allocateAligned(size_t bytes, size_t alignment) {
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32__)
+        return _aligned_malloc(bytes, alignment);
+#else
+        void *p = NULL;
+        if (posix_memalign(&p, alignment, bytes) != 0)
+            return NULL;
+        return p;
+#endif
+    }
+
+    static void freeAligned(void *p) {
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32__)
+        _aligned_free(p);
+#else
+        free(p);
+#endif
+    }
+
+public:
+    Framebuffer(unsigned int width = 0, unsigned int height = 0) : width(width), height(height), pixels(NULL) {
+    }
+
+    unsigned int getWidth() {
+        return width;
+    }
+
+    unsigned int getHeight() {
+        return height;
+    }
+
+    size_t bytes() {
+        return (size_t) width * height * sizeof(Color);
+    }
+
+    bool allocated() {
+        return pixels != NULL;
+    }
+
+    // Meretvaltaskor a regi kepet eldobja, az uj csak a kovetkezo data() hivasnal foglalodik
+    void resize(unsigned int w, unsigned int h) {
+        if (w == width && h == height) return;
+        release();
+        width = w;
+        height = h;
+    }
+
+    // A pixelek nincsenek inicializalva, a renderelo minden pixelt felulir (ld. clear())
+    Color *data() {
+        if (pixels == NULL && width > 0 && height > 0) {
+            size_t size = bytes();
+            size_t alignment = size >= HUGE_PAGE ? HUGE_PAGE : CACHE_LINE;
+            size = (size + alignment - 1) / alignment * alignment;
+
+            pixels = (Color *) allocateAligned(size, alignment);
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+            if (pixels != NULL && alignment == HUGE_PAGE)
+                madvise(pixels, size, MADV_HUGEPAGE);
+#endif
+        }
+        return pixels;
+    }
+
+    void clear() {
+        Color *p = data();
+        if (p != NULL)
+            std::fill(p, p + (size_t) width * height, Color());
+    }
+
+    Color &operator()(unsigned int x, unsigned int y) {
+        return pixels[(size_t) y * width + x];
+    }
+
+    void release() {
+        if (pixels != NULL)
+            freeAligned(pixels);
+        pixels = NULL;
+    }
+
+    ~Framebuffer() {
+        release();
+    }
+};
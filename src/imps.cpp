@@ -2,24 +2,32 @@
 
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <stdexcept>
+#include <utility>
 
-#if defined(__APPLE__)
-
-#include <OpenGL/gl.h>
-#include <OpenGL/glu.h>
-#include <GLUT/glut.h>
-
-#else
-#if defined(WIN32) || defined(_WIN32) || defined(__WIN32__)
-#include <windows.h>
-#endif
-#include <GL/gl.h>
-#include <GL/glu.h>
-#include <GL/glut.h>
+#if defined(_WIN32)
+#include <malloc.h>
 #endif
+
+// A tracer mag nem fugg az OpenGL/GLUT-tol, igy a fej nelkuli (headless) renderelo is hasznalhatja
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
 const float FLOAT_MAX = powf(10, 37);
+const float RAY_EPSILON = 0.01f;
+static const int MAX_TRACE_DEPTH = 32;    // a World maxTrace erteke legfeljebb ennyi lehet
+
+// fminf/fmaxf NaN kezelese miatt sokszor konyvtari hivas lesz, ezek egy utasitasra fordulnak
+inline float minf(float a, float b) {
+    return a < b ? a : b;
+}
+
+inline float maxf(float a, float b) {
+    return a > b ? a : b;
+}
+
+#include "stats.cpp"
 
 //--------------------------------------------------------
 // 3D Vektor
@@ -34,6 +42,10 @@ struct Vector {
     Vector(float x, float y, float z) : x(x), y(y), z(z) {
     }
 
+    float operator[](int i) const {
+        return (&x)[i];
+    }
+
     Vector operator*(float a) {
         return Vector(x * a, y * a, z * a);
     }
@@ -69,6 +81,13 @@ struct Vector {
     Vector normalize() {
         return (*this) / this->length();
     }
+
+    // Slab tesztekhez: a 0 komponensek helyett nagy, de veges ertek, hogy ne keletkezzen NaN
+    Vector inverse() {
+        return Vector(fabsf(x) > 1e-20f ? 1.0f / x : copysignf(1e20f, x),
+                      fabsf(y) > 1e-20f ? 1.0f / y : copysignf(1e20f, y),
+                      fabsf(z) > 1e-20f ? 1.0f / z : copysignf(1e20f, z));
+    }
 };
 
 //--------------------------------------------------------
@@ -174,6 +193,10 @@ struct Point {
     Point(float x, float y, float z) : x(x), y(y), z(z) {
     }
 
+    float operator[](int i) const {
+        return (&x)[i];
+    }
+
     Point operator+(const Vector &p) {
         return Point(x + p.x, y + p.y, z + p.z);
     }
@@ -196,6 +219,56 @@ struct Point {
 };
 
 
+//--------------------------------------------------------
+// Axis aligned bounding box
+//--------------------------------------------------------
+struct AABB {
+    Point pmin, pmax;
+
+    AABB() : pmin(FLOAT_MAX, FLOAT_MAX, FLOAT_MAX), pmax(-FLOAT_MAX, -FLOAT_MAX, -FLOAT_MAX) {
+    }
+
+    AABB(Point pmin, Point pmax) : pmin(pmin), pmax(pmax) {
+    }
+
+    void grow(const Point &p) {
+        pmin = Point(minf(pmin.x, p.x), minf(pmin.y, p.y), minf(pmin.z, p.z));
+        pmax = Point(maxf(pmax.x, p.x), maxf(pmax.y, p.y), maxf(pmax.z, p.z));
+    }
+
+    void grow(const AABB &b) {
+        grow(b.pmin);
+        grow(b.pmax);
+    }
+
+    bool empty() const {
+        return pmin.x > pmax.x || pmin.y > pmax.y || pmin.z > pmax.z;
+    }
+
+    Point centroid() const {
+        return Point((pmin.x + pmax.x) * 0.5f, (pmin.y + pmax.y) * 0.5f, (pmin.z + pmax.z) * 0.5f);
+    }
+
+    float area() const {
+        if (empty()) return 0.0f;
+        float dx = pmax.x - pmin.x, dy = pmax.y - pmin.y, dz = pmax.z - pmin.z;
+        return 2.0f * (dx * dy + dy * dz + dz * dx);
+    }
+
+    // Slab teszt, tnear a belepesi pont parametere
+    bool intersect(const Point &o, const Vector &invDir, float tmin, float tmax, float &tnear) const {
+        float tx1 = (pmin.x - o.x) * invDir.x, tx2 = (pmax.x - o.x) * invDir.x;
+        float ty1 = (pmin.y - o.y) * invDir.y, ty2 = (pmax.y - o.y) * invDir.y;
+        float tz1 = (pmin.z - o.z) * invDir.z, tz2 = (pmax.z - o.z) * invDir.z;
+
+        float t0 = maxf(maxf(minf(tx1, tx2), minf(ty1, ty2)), minf(tz1, tz2));
+        float t1 = minf(minf(maxf(tx1, tx2), maxf(ty1, ty2)), maxf(tz1, tz2)) * 1.0000004f;
+
+        tnear = t0;
+        return t0 <= t1 && t1 > tmin && t0 < tmax;
+    }
+};
+
 //--------------------------------------------------------
 // Spektrum illetve szin
 //--------------------------------------------------------
@@ -261,6 +334,106 @@ struct Ray {
     }
 };
 
+//--------------------------------------------------------
+// RayPacket
+//--------------------------------------------------------
+// Koherens (elsodleges) sugarak SoA elrendezesben, hogy a metszotesztek savonkent vektorizalhatok legyenek
+static const int PACKET_SIZE = 8;
+
+//--------------------------------------------------------
+// ObjectHandle
+//--------------------------------------------------------
+// 32 bites objektum-azonosito: a felso 4 bit a tipus, az also 28 bit az index a tipus sajat tombjeben.
+typedef unsigned int ObjectHandle;
+
+enum ObjectType {
+    OBJECT_SPHERE = 0,
+    OBJECT_QUADRIC = 1,
+    OBJECT_PLANE = 2,
+    OBJECT_CYLINDER = 3,
+    OBJECT_PARABOLOID = 4,
+    OBJECT_PART = 5,         // megosztott alapalak elforgatott, atskalazott peldanya
+    OBJECT_INSTANCE = 6      // objektumcsoport (Model) tetszoleges affin transzformaciovel elhelyezett peldanya
+};
+
+static const ObjectHandle NO_OBJECT = 0xffffffffu;
+static const int MAX_HANDLE_INDEX = 0x0fffffff;    // tipusonkent legfeljebb ennyi + 1 objektum
+
+inline ObjectHandle makeHandle(ObjectType type, int index) {
+    return ((ObjectHandle) type << 28) | (ObjectHandle) index;
+}
+
+inline ObjectType handleType(ObjectHandle handle) {
+    return (ObjectType) (handle >> 28);
+}
+
+inline int handleIndex(ObjectHandle handle) {
+    return (int) (handle & 0x0fffffffu);
+}
+
+struct RayPacket {
+    alignas(32) float ox[PACKET_SIZE];
+    alignas(32) float oy[PACKET_SIZE];
+    alignas(32) float oz[PACKET_SIZE];
+    alignas(32) float dx[PACKET_SIZE];
+    alignas(32) float dy[PACKET_SIZE];
+    alignas(32) float dz[PACKET_SIZE];
+    alignas(32) float t[PACKET_SIZE];
+    alignas(32) int active[PACKET_SIZE];
+    ObjectHandle object[PACKET_SIZE];
+
+    RayPacket() {
+        for (int i = 0; i < PACKET_SIZE; i++) {
+            ox[i] = oy[i] = oz[i] = dx[i] = dy[i] = 0.0f;
+            dz[i] = 1.0f;
+            t[i] = FLOAT_MAX;
+            active[i] = 0;
+            object[i] = NO_OBJECT;
+        }
+    }
+
+    void set(int i, Ray &ray) {
+        ox[i] = ray.p0.x;
+        oy[i] = ray.p0.y;
+        oz[i] = ray.p0.z;
+        dx[i] = ray.v.x;
+        dy[i] = ray.v.y;
+        dz[i] = ray.v.z;
+        t[i] = FLOAT_MAX;
+        active[i] = 1;
+        object[i] = NO_OBJECT;
+    }
+
+    Ray getRay(int i) {
+        return Ray(Point(ox[i], oy[i], oz[i]), Vector(dx[i], dy[i], dz[i]));
+    }
+};
+
+
+//--------------------------------------------------------
+// Camera
+//--------------------------------------------------------
+struct Camera {
+    Point eye;
+    Point lookAt;
+    Vector right, up;
+    float scale;
+
+    Camera() : scale(1.0f) {
+    }
+
+    Camera(Point eye, Point lookAt, float scale) : eye(eye), lookAt(lookAt), scale(scale) {
+        Vector direction = (lookAt - eye).normalize();
+        right = (direction % Vector(0.0f, 0.0f, 1.0f)).normalize();
+        up = (right % direction).normalize();
+    }
+
+    // A kepsik a lookAt pontban van, x es y pixelkoordinatak (0, 0 a bal also sarok)
+    Ray getRay(float x, float y, unsigned int width, unsigned int height) {
+        Point pixel = lookAt + right * (2.0f * x / width - 1.0f) * scale + up * (2.0f * y / height - 1.0f) * scale;
+        return Ray(pixel, (pixel - eye).normalize());
+    }
+};
 
 //--------------------------------------------------------
 // Light
@@ -286,111 +459,267 @@ struct Light {
 //--------------------------------------------------------
 // Surface
 //--------------------------------------------------------
+// A szarmaztatott tagokat (f0, 1 - f0, navg) a konstruktor szamolja ki, anyagonkent egyszer
 struct Surface {
     Color k;
     Color n;
     Color f0;
+    Color f0inv;
 
     float shininess;
     float navg;
     bool refractive;
     bool reflective;
 
+    Surface() : shininess(1.0f), navg(1.0f), refractive(false), reflective(false) {
+    }
+
     Surface(Color k, Color n, float shininess, bool refractive, bool reflective)
             : k(k), n(n), shininess(shininess), refractive(refractive), reflective(reflective) {
         f0 = ((n - 1.0f) * (n - 1.0f) + k * k) / ((n + 1.0f) * (n + 1.0f) + k * k);
+        f0inv = f0.inverse();
         navg = (n.r + n.g + n.b) / 3.0f;
     }
 
     Color fresnel(Vector &v, Vector &n) {
-        return f0 + f0.inverse() * powf(1.0f - cosf(fabsf(n * v)), 5);
+        return f0 + f0inv * powf(1.0f - cosf(fabsf(n * v)), 5);
+    }
+
+    static Vector reflectDir(Ray &ray, Vector &n) {
+        return ray.v + n * (n.negate() * ray.v) * 2;
+    }
+
+    bool refractDir(Ray &ray, Vector &n, Vector &dir, bool out) {
+        float cosa = ray.v.normalize() * n.negate();
+
+        float cn = (out) ? 1.0f / navg : navg;
+        float disc = 1 - (1 - cosa * cosa) / (cn * cn);
+
+        if (disc < 0.0f)
+            return false;
+
+        dir = (ray.v / cn + n * (cosa / cn - sqrtf(disc)) + ray.v / cn).normalize();
+        return true;
     }
 };
 
 
 //--------------------------------------------------------
-// Object
+// DynamicArray
 //--------------------------------------------------------
-class Object {
-    float bvR;
-    Point bvP0;
+// Noveheto tomb: betelve a kapacitasa duplazodik, az elemeket athelyezi (move). A tarolo ARRAY_ALIGNMENT
+// byte-ra igazitott, igy a SIMD kernelek blokkjai es a cache sorok egybeesnek. A capacity konstruktor
+// parameter csak elore foglal, nem felso korlat; ha a meret nem abrazolhato, vagy elfogy a memoria,
+// std::length_error, illetve std::bad_alloc kivetelt dob, elemet soha nem dob el csendben.
+static const size_t ARRAY_ALIGNMENT = 64;
+
+inline void *alignedAlloc(size_t bytes) {
+#if defined(_WIN32)
+    void *p = _aligned_malloc(bytes, ARRAY_ALIGNMENT);
+#else
+    void *p = NULL;
+    if (posix_memalign(&p, ARRAY_ALIGNMENT, bytes) != 0)
+        p = NULL;
+#endif
+    if (p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+
+inline void alignedFree(void *p) {
+#if defined(_WIN32)
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
 
-protected:
-    bool intersectBV(Ray &ray) {
-        float d = ray.v.length();
-        float t = -1.0f * ((bvP0 - ray.p0) * ray.v / (d * d));
+template<class T>
+class DynamicArray {
+    static const int MAX_CAPACITY = 0x7fffffff;
 
-        return ray.getPoint(t).distance(bvP0) <= bvR;
-    }
+    T *array;
+    int capacity;
 
-    bool closestRoot(float a, float b, float c, float &t) {
-        float disc = b * b - 4.0f * a * c;
+    DynamicArray(const DynamicArray &) = delete;
+    DynamicArray &operator=(const DynamicArray &) = delete;
 
-        if (disc < 0.0f) return false;
+    // Uj tarolo legalabb n elemre, de legalabb a regi ketszeresere
+    static int grownCapacity(int capacity, int n) {
+        if (n < 0)
+            throw std::length_error("DynamicArray: negative capacity");
+        if (capacity > MAX_CAPACITY / 2)
+            return MAX_CAPACITY;
+        int c = capacity > 0 ? capacity * 2 : 16;
+        return c > n ? c : n;
+    }
 
-        float t1 = (-1.0f * b + sqrtf(disc)) / (2.0f * a);
-        float t2 = (-1.0f * b - sqrtf(disc)) / (2.0f * a);
+    static T *allocate(int n) {
+        if ((size_t) n > (size_t) -1 / sizeof(T))
+            throw std::length_error("DynamicArray: capacity overflow");
+        return static_cast<T *>(alignedAlloc((size_t) n * sizeof(T)));
+    }
 
-        t = (t1 < t2) ? t1 : t2;
-        return true;
+    // A regi elemeket atteszi a target-be es felszabaditja a regi tarolot
+    void moveTo(T *target, int newCapacity) {
+        for (int i = 0; i < size; i++) {
+            new(target + i) T(std::move(array[i]));
+            array[i].~T();
+        }
+        if (array != NULL)
+            alignedFree(array);
+        array = target;
+        capacity = newCapacity;
     }
 
 public:
-    Surface surface;
+    int size;
 
-    Object(Surface surface, float bvR, Point bvP0)
-            : surface(surface), bvR(bvR), bvP0(bvP0) {
-    };
+    DynamicArray() : array(NULL), capacity(0), size(0) {
+    }
 
-    Vector reflectDir(Ray &ray, Vector &n) {
-        return ray.v + n * (n.negate() * ray.v) * 2;
+    explicit DynamicArray(int capacity) : array(NULL), capacity(0), size(0) {
+        reserve(capacity);
     }
 
-    bool refractDir(Ray &ray, Vector &n, Vector &dir, bool &out) {
-        float cosa = ray.v.normalize() * n.negate();
+    DynamicArray(DynamicArray &&o) : array(o.array), capacity(o.capacity), size(o.size) {
+        o.array = NULL;
+        o.capacity = o.size = 0;
+    }
 
-        float cn = (out) ? 1.0f / surface.navg : surface.navg;
-        float disc = 1 - (1 - cosa * cosa) / (cn * cn);
+    // Legalabb n elemnyi helyet foglal, utana n elemig a push nem foglal ujra
+    void reserve(int n) {
+        if (n <= capacity) return;
+        moveTo(allocate(n), n);
+    }
 
-        if (disc < 0.0f)
-            return false;
+    // Az uj elemet meg a regi elemek athelyezese elott letrehozza, igy a sajat elemunkbol is lehet masolni
+    template<class... Args>
+    T &emplace(Args &&... args) {
+        if (size == capacity) {
+            if (size == MAX_CAPACITY)
+                throw std::length_error("DynamicArray: too many elements");
+            int c = grownCapacity(capacity, size + 1);
+            T *target = allocate(c);
+            try {
+                new(target + size) T(std::forward<Args>(args)...);
+            } catch (...) {
+                alignedFree(target);
+                throw;
+            }
+            moveTo(target, c);
+        } else {
+            new(array + size) T(std::forward<Args>(args)...);
+        }
+        return array[size++];
+    }
 
-        dir = (ray.v / cn + n * (cosa / cn - sqrtf(disc)) + ray.v / cn).normalize();
-        return true;
+    void push(const T &o) {
+        emplace(o);
     }
 
-    virtual bool intersect(Ray &ray, float &t, Vector &n) = 0;
+    void push(T &&o) {
+        emplace(std::move(o));
+    }
 
-    virtual ~Object() {
-    };
+    void clear() {
+        for (int i = 0; i < size; i++)
+            array[i].~T();
+        size = 0;
+    }
+
+    T &operator[](int index) {
+        return array[index];
+    }
+
+    const T &operator[](int index) const {
+        return array[index];
+    }
+
+    // Nyers mutatok, a range-for es a fordito vektorizaloja szamara is egyszeru, folytonos ciklust adnak
+    T *data() {
+        return array;
+    }
+
+    T *begin() {
+        return array;
+    }
+
+    T *end() {
+        return array + size;
+    }
+
+    ~DynamicArray() {
+        clear();
+        if (array != NULL)
+            alignedFree(array);
+    }
 };
 
+#include "arena.cpp"
+#include "materials.cpp"
+#include "quadrics.cpp"
+#include "solids.cpp"
+#include "objects.cpp"
+#include "spheres.cpp"
+#include "bvh.cpp"
+#include "instances.cpp"
+
 //--------------------------------------------------------
-// DynamicArray
+// PathStack
 //--------------------------------------------------------
-template<class T>
-class DynamicArray {
-    int capacity;
-    T *array;
+// A meg kovetendo tukor- es toresi sugarak, a pixelig visszaszorzott sulyukkal (throughput).
+// Melysegi bejarasnal szintenkent legfeljebb egy testver var, igy MAX_TRACE_DEPTH + 2 hely mindig eleg.
 
-public:
+struct PathVertex {
+    Point p0;
+    Vector v;
+    Color weight;    // a pixel szinehez ezzel szorozva adodik hozza a sugar hozzajarulasa
+    Color power;     // a szulo talalat Fresnel-egyutthatoja
+    int depth;
+    bool out;
+
+    PathVertex() : depth(0), out(false) {
+    }
+
+    PathVertex(Ray &ray, Color weight, Color power, int depth, bool out)
+            : p0(ray.p0), v(ray.v), weight(weight), power(power), depth(depth), out(out) {
+    }
+
+    Ray getRay() {
+        return Ray(p0, v);
+    }
+};
+
+class PathStack {
+    PathVertex vertices[MAX_TRACE_DEPTH + 2];
     int size;
+    unsigned int seed;
 
-    DynamicArray(int capacity) : capacity(capacity), size(0), array(NULL) {
-        array = new T[capacity];
+public:
+    // A seed a Russian roulette veletlenszamaihoz kell, pixelenkent rogzitett, hogy a kep ne fuggjon a szalaktol
+    PathStack(unsigned int seed = 1) : size(0), seed(seed != 0 ? seed : 1) {
     }
 
-    void push(const T &o) {
-        if (size < capacity)
-            array[size++] = o;
+    // xorshift32, [0, 1)
+    float random() {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return (seed >> 8) * (1.0f / 16777216.0f);
     }
 
-    T &operator[](int index) {
-        return array[index];
+    bool empty() {
+        return size == 0;
     }
 
-    ~DynamicArray() {
-        delete[] array;
+    void push(const PathVertex &vertex) {
+        if (size < MAX_TRACE_DEPTH + 2)
+            vertices[size++] = vertex;
+    }
+
+    PathVertex pop() {
+        return vertices[--size];
     }
 };
 
@@ -400,46 +729,102 @@ public:
 class World {
     Color ambientLight;
     int maxTrace;
+    float minThroughput;    // ennel kisebb sulyu agakat nem kovetunk (0: kikapcsolva)
+    bool russianRoulette;   // eldobas helyett p = suly / minThroughput valoszinuseggel tovabbvisszuk, 1/p-vel sulyozva
+    Arena arena;            // a BVH tombjei; build() uriti, a World-del egyutt egyben szabadul fel
+    BVH bvh;
+    BVHBuildOptions bvhOptions;    // az utolso build beallitasai, refit ezekkel epit ujra
+    Arena modelArena;       // a modellek BVH-i; build() nem uriti, mert a modelleket csak egyszer epitjuk
+    DynamicArray<Model *> models;
+
+    // A sugar seed-je az iranyabol: pixelenkent mas, de futasrol futasra ugyanaz
+    static unsigned int seedFor(Ray &ray) {
+        unsigned int h = 2166136261u;
+        float f[6] = {ray.p0.x, ray.p0.y, ray.p0.z, ray.v.x, ray.v.y, ray.v.z};
+        for (int i = 0; i < 6; i++) {
+            unsigned int bits;
+            memcpy(&bits, &f[i], sizeof(bits));
+            h = (h ^ bits) * 16777619u;
+        }
+        return h;
+    }
+
+    // Az elhanyagolhato sulyu agak levagasa; true, ha a sugarat (esetleg atsulyozva) kovetni kell
+    bool survives(Color &weight, PathStack &stack) {
+        float w = maxf(weight.r, maxf(weight.g, weight.b));
+        if (w >= minThroughput)
+            return true;
+        if (!russianRoulette)
+            return false;
 
-    bool firstIntersect(Ray &r, float &t, Object *&o, Vector &n) {
-        bool intersected = false;
-        for (int i = 0; i < objects.size; i++) {
-            Vector n_temp;
-            float t_temp;
-            if (objects[i]->intersect(r, t_temp, n_temp)) {
-                if (t_temp > 0.01f && t_temp < t) {
+        float p = w / minThroughput;
+        if (stack.random() >= p)
+            return false;
+        weight = weight * (1.0f / p);
+        return true;
+    }
+
+    // true, ha a sugarat tenyleg kovetni is fogjuk (nem vagtuk le, es nem lepi tul maxTrace-t)
+    bool pushPath(PathStack &stack, Ray &ray, Color weight, Color power, int depth, bool out) {
+        if (!survives(weight, stack))
+            return false;
+        stack.push(PathVertex(ray, weight, power, depth, out));
+        return depth <= maxTrace;
+    }
+
+    // A legkozelebbi talalat; a normalist csak a vegso talalatra szamoljuk ki
+    bool firstIntersect(Ray &r, float &t, ObjectHandle &o, Vector &n) {
+        bool intersected;
+        if (bvh.built()) {
+            intersected = bvh.intersect(r, t, o);
+        } else {
+            intersected = false;
+            int count = objects.size();
+            RAY_STAT_ADD(intersectionTests, count);
+            for (int i = 0; i < count; i++) {
+                float t_temp;
+                ObjectHandle h = objects.handle(i);
+                if (objects.intersect(h, r, t_temp) && t_temp > RAY_EPSILON && t_temp < t) {
                     t = t_temp;
-                    n = n_temp;
-                    o = objects[i];
+                    o = h;
                     intersected = true;
                 }
             }
         }
+
+        if (intersected) {
+            n = objects.normalAt(o, r, t);
+        }
         return intersected;
     }
 
-    bool firstIntersect(Ray &r, float &t) {
-        Object *o;
-        Vector n;
-        return firstIntersect(r, t, o, n);
-    }
+    bool occluded(Ray &r, float tmin, float tmax) {
+        if (bvh.built())
+            return bvh.occluded(r, tmin, tmax);
 
+        int count = objects.size();
+        for (int i = 0; i < count; i++) {
+            float t;
+            RAY_STAT(intersectionTests);
+            if (objects.intersect(objects.handle(i), r, t) && t > tmin && t < tmax)
+                return true;
+        }
+        return false;
+    }
 
-    Color directLight(Point &p, Ray &ray, Vector &n, Object *object) {
-        Color color = object->surface.k * ambientLight;
+    Color directLight(Point &p, Ray &ray, Vector &n, Surface &surface) {
+        Color color = surface.k * ambientLight;
 
         for (int i = 0; i < lights.size; i++) {
             Ray shadowRay(p, (lights[i].p0 - p).normalize());
             float lightDistance = lights[i].p0.distance(p);
+            RAY_STAT(shadowRays);
 
-            float t = FLOAT_MAX;
-            bool intersect = firstIntersect(shadowRay, t);
-
-            if (!intersect || p.distance(shadowRay.getPoint(t)) > lightDistance) {
+            if (!occluded(shadowRay, RAY_EPSILON, lightDistance)) {
                 float costheta = shadowRay.v * n;
-                Color diffuseLight = (costheta > 0.0f) ? object->surface.k * costheta : Color();
+                Color diffuseLight = (costheta > 0.0f) ? surface.k * costheta : Color();
                 float cosphi = (shadowRay.v.negate() + ray.v).normalize() * n;
-                Color blinnShine = (cosphi > 0.0f) ? object->surface.n * powf(cosphi, object->surface.shininess) : Color();
+                Color blinnShine = (cosphi > 0.0f) ? surface.n * powf(cosphi, surface.shininess) : Color();
                 color = color + (diffuseLight + blinnShine) * lights[i].color * lights[i].getIntensity(lightDistance);
             }
         }
@@ -447,151 +832,185 @@ class World {
         return color;
     }
 
+    // Refit utan: ha a SAH koltseg rebuildThreshold-szorosanal jobban leromlott, ujraepitjuk
+    bool rebuildIfDegraded() {
+        if (bvhOptions.rebuildThreshold <= 0.0f || bvh.degradation() <= bvhOptions.rebuildThreshold)
+            return false;
+        build(bvhOptions);
+        return true;
+    }
+
 public:
-    DynamicArray<Object *> objects;
+    ObjectStore objects;
     DynamicArray<Light> lights;
     Color background;
 
-    World(int maxObjects, int maxLights, Color background, Color ambientLight, int maxTrace)
-            : objects(maxObjects),
-              lights(maxLights),
-              background(background),
-              ambientLight(ambientLight),
-              maxTrace(maxTrace) {
+    World(Color background, Color ambientLight, int maxTrace)
+            : ambientLight(ambientLight),
+              maxTrace(maxTrace < MAX_TRACE_DEPTH ? maxTrace : MAX_TRACE_DEPTH),
+              minThroughput(0.001f),
+              russianRoulette(false),
+              background(background) {
 
     }
 
-    Color trace(Ray &ray, Color power = Color(), int d = 0, bool out = false) {
-        if (d > maxTrace)
-            return background * 0.5f;
-
-        Color color;
-        float t = FLOAT_MAX;
-        Vector n;
-        Object *object;
+    ~World() {
+        for (int i = 0; i < models.size; i++)
+            delete models[i];
+    }
 
-        if (!firstIntersect(ray, t, object, n)) {
-            return background * 0.5f;
-        }
+    // minThroughput = 0 minden agat maxTrace melysegig kovet, ahogy a rekurziv valtozat
+    void setPathPruning(float minThroughput, bool russianRoulette) {
+        this->minThroughput = minThroughput > 0.0f ? minThroughput : 0.0f;
+        this->russianRoulette = russianRoulette && minThroughput > 0.0f;
+    }
 
+    // A talalat sajat (kozvetlen) fenye, sulyozatlanul; a tukor- es toresi sugarakat a verembe teszi
+    Color shade(Ray &ray, float t, Vector &n, ObjectHandle object, PathVertex &vertex, PathStack &stack) {
         Point point = ray.getPoint(t);
+        Surface &surface = objects.surface(object);
+
+        Color color = directLight(point, ray, n, surface);
+
+        // Forditott sorrendben kerulnek a verembe, hogy a tukorsugarat kovessuk elobb, mint a rekurziv valtozat
+        Color fresnel = surface.fresnel(ray.v, n);
+        if (surface.refractive) {
+            // A normalissal egy iranyba halado sugar belulrol talalta el a testet (a veges testek a kilepesi
+            // pontot is visszaadjak): ekkor kifele torunk, a sugar feloli normalissal
+            Vector nr = n;
+            bool out = vertex.out;
+            if (n * ray.v > 0.0f) {
+                nr = n.negate();
+                out = true;
+            }
 
-        color = directLight(point, ray, n, object);
-
-        Color fresnel = object->surface.fresnel(ray.v, n);
-        if (object->surface.reflective) {
-            Ray reflectRay = Ray(point, object->reflectDir(ray, n));
-            color = color + fresnel * trace(reflectRay, fresnel, d + 1);
-        }
-
-        if (object->surface.refractive) {
             Vector dir;
-            if (object->refractDir(ray, n, dir, out)) {
+            if (surface.refractDir(ray, nr, dir, out)) {
                 Ray refractRay = Ray(point, dir);
                 Color fresnel2 = fresnel * -1.0f + 1.0f;
-                color = color + fresnel2 * trace(refractRay, fresnel2, d + 1, !out);
+                if (pushPath(stack, refractRay, vertex.weight * fresnel2, fresnel2, vertex.depth + 1, !out))
+                    RAY_STAT(refractionRays);
             }
         }
 
-        if (!object->surface.refractive && !object->surface.reflective && d > 0) {
-            color = color + power * 0.1f;
+        if (surface.reflective) {
+            Ray reflectRay = Ray(point, Surface::reflectDir(ray, n));
+            if (pushPath(stack, reflectRay, vertex.weight * fresnel, fresnel, vertex.depth + 1, false))
+                RAY_STAT(reflectionRays);
         }
 
-        return color;
-    }
-
-    ~World() {
-        for (int i = 0; i < objects.size; i++) {
-            delete objects[i];
+        if (!surface.refractive && !surface.reflective && vertex.depth > 0) {
+            color = color + vertex.power * 0.1f;
         }
-    }
-};
-
-
-//--------------------------------------------------------
-// EllipsoidObject
-//--------------------------------------------------------
-class EllipsoidObject : public Object {
-    QMatrix Q;
-
-public:
-    EllipsoidObject(Surface surface, QMatrix Q) : Object(surface, 0.0f, Point()), Q(Q) {
 
+        return color;
     }
 
-    bool intersect(Ray &ray, float &t, Vector &n) {
-        //if (!intersectBV(ray)) return false;
+    // Amig a verem ki nem urul, a legfelso sugarat kovetjuk; a hozzajarulasok sullyal szorozva osszegzodnek
+    Color integrate(PathStack &stack) {
+        Color color;
 
-        QVector rayv(ray.v);
-        QVector rayp0(ray.p0.vectorFromOrigo());
+        while (!stack.empty()) {
+            PathVertex vertex = stack.pop();
+            if (vertex.depth > maxTrace) {
+                color = color + vertex.weight * (background * 0.5f);
+                continue;
+            }
 
-        float a = rayv * Q * rayv;
-        float b = rayv * 2 * Q * rayp0;
-        float c = rayp0 * Q * rayp0;
+            RAY_STAT(depthHistogram[vertex.depth]);
+            Ray ray = vertex.getRay();
+            float t = FLOAT_MAX;
+            Vector n;
+            ObjectHandle object;
 
-        if (!closestRoot(a, b, c, t)) {
-            return false;
-        }
+            if (!firstIntersect(ray, t, object, n)) {
+                color = color + vertex.weight * (background * 0.5f);
+                continue;
+            }
 
-        Point p = ray.getPoint(t);
+            color = color + vertex.weight * shade(ray, t, n, object, vertex, stack);
+        }
 
-        Vector temp(
-                Q.m[0][0] * p.x + Q.m[1][0] * p.y + Q.m[2][0] * p.z + Q.m[3][0],
-                Q.m[0][1] * p.x + Q.m[1][1] * p.y + Q.m[2][1] * p.z + Q.m[3][1],
-                Q.m[0][2] * p.x + Q.m[1][2] * p.y + Q.m[2][2] * p.z + Q.m[3][2]
-        );
+        return color;
+    }
 
-        n = temp.normalize();
+    // A jelenet osszeallitasa utan kell meghivni, a gyorsitostrukturat epiti fel
+    void build(const BVHBuildOptions &options = BVHBuildOptions()) {
+        bvhOptions = options;
+        arena.reset();
+        bvh.build(objects, arena, options);
+    }
 
-        return true;
+    const BVHBuildStats &buildStats() {
+        return bvh.buildStats();
     }
-};
 
-//--------------------------------------------------------
-// SphereObject
-//--------------------------------------------------------
-class SphereObject : public Object {
-    float r;
-    Point p0;
+    // Uj, ures modell, a World-del egyutt szabadul fel; az objektumai felvetele utan buildModel-lel kell
+    // felepiteni, mielott peldany keszulne belole
+    Model *addModel() {
+        Model *model = new Model();
+        models.push(model);
+        return model;
+    }
 
-public:
-    SphereObject(Surface surface, float r, Point p0) : Object(surface, r, p0), r(r), p0(p0) {
+    void buildModel(Model *model) {
+        model->build(modelArena);
+    }
 
+    // Peldanyok mozgatasa (ObjectStore::setTransform) utan eleg a felso szint dobozait frissiteni. Ha a fa SAH
+    // koltsege ettol rebuildThreshold-szorosanal jobban leromlott, ujraepitjuk; true, ha ujraepult.
+    bool refit() {
+        bvh.refit();
+        return rebuildIfDegraded();
     }
 
-    bool intersect(Ray &ray, float &t, Vector &n) {
-        //if (!intersectBV(ray)) return false;
+    // Ugyanez, ha ismert, mely peldanyok mozdultak: a koltseg a mozgatottak szamaval aranyos
+    bool refit(const ObjectHandle *moved, int count) {
+        bvh.refit(moved, count);
+        return rebuildIfDegraded();
+    }
 
-        Vector temp(ray.p0 - p0);
+    // Az aktualis SAH koltseg per az epiteskori; refit utan no, ujraepites utan ujra 1
+    float bvhDegradation() {
+        return bvh.degradation();
+    }
 
-        float a = ray.v * ray.v;
-        float b = temp * ray.v * 2.0f;
-        float c = temp * temp - (r * r);
+    // Rekurzio helyett explicit verem: a hivas stackje fix meretu, a sugarfa melysege maxTrace
+    Color trace(Ray &ray) {
+        RAY_STAT(primaryRays);
+        PathStack stack(seedFor(ray));
+        stack.push(PathVertex(ray, Color(1.0f, 1.0f, 1.0f), Color(), 0, false));
+        return integrate(stack);
+    }
 
-        if (!closestRoot(a, b, c, t)) {
-            return false;
+    // Elsodleges sugarcsomag: a metszes csomagban, az arnyalas es a masodlagos sugarak skalarisan
+    void tracePacket(RayPacket &packet, Color *colors) {
+        if (bvh.built()) {
+            bvh.intersect(packet);
+        } else {
+            int count = objects.size();
+            for (int i = 0; i < PACKET_SIZE; i++)
+                RAY_STAT_ADD(intersectionTests, packet.active[i] ? count : 0);
+            for (int i = 0; i < count; i++)
+                objects.intersectPacket(objects.handle(i), packet);
         }
 
-        n = ((ray.getPoint(t) - p0) / r).normalize();
-
-        return true;
-    }
-};
-
-//--------------------------------------------------------
-// GroundObject
-//--------------------------------------------------------
-class GroundObject : public Object {
-    bool intersect(Ray &ray, float &t, Vector &n) {
-        if (ray.v.z == 0)
-            return false;
-        t = (-1.0f * ray.p0.z) / ray.v.z;
-        n = Vector(0.0f, 0.0f, 1.0f);
-        return true;
-    }
+        for (int i = 0; i < PACKET_SIZE; i++) {
+            if (!packet.active[i]) continue;
+            RAY_STAT(primaryRays);
+            RAY_STAT(depthHistogram[0]);
+            if (packet.object[i] == NO_OBJECT || maxTrace < 0) {
+                colors[i] = background * 0.5f;
+                continue;
+            }
 
-public:
-    GroundObject(Surface surface) : Object(surface, 0.0f, Point()) {
+            Ray ray = packet.getRay(i);
+            Vector n = objects.normalAt(packet.object[i], ray, packet.t[i]);
 
+            PathStack stack(seedFor(ray));
+            PathVertex primary(ray, Color(1.0f, 1.0f, 1.0f), Color(), 0, false);
+            Color color = shade(ray, packet.t[i], n, packet.object[i], primary, stack);
+            colors[i] = color + integrate(stack);
+        }
     }
-};
\ No newline at end of file
+};
@@ -0,0 +1,156 @@
+//--------------------------------------------------------
+// Model es peldanyai (instancing)
+//--------------------------------------------------------
+// Ketszintu gyorsitostruktura: minden egyedi objektumcsoport (Model) a sajat rendszereben epitett, sajat BVH-t
+// kap (also szint), a World BVH-ja pedig a peldanyok dobozait tartalmazza a tobbi objektum mellett (felso szint).
+// A memoria az egyedi geometriaval no, peldanyonkent csak a ket matrix es a doboz tarolodik. Modell is
+// tartalmazhat masik modellbol keszult peldanyt, igy a hierarchia tobb szintu is lehet.
+
+// Sorvektoros konvencio, mint a QMatrix * QVector: p' = p M, az eltolas a negyedik sorban van
+inline Point transformPoint(QMatrix &M, Point p) {
+    QVector q = M * QVector(p.x, p.y, p.z, 1.0f);
+    return Point(q.x, q.y, q.z);
+}
+
+inline Vector transformDirection(QMatrix &M, Vector v) {
+    QVector q = M * QVector(v.x, v.y, v.z, 0.0f);
+    return Vector(q.x, q.y, q.z);
+}
+
+// Affin transzformacio inverze: a 3x3-as resz inverze (adjungalttal), az eltolas -t A^-1
+inline QMatrix affineInverse(const QMatrix &M) {
+    const float (*a)[4] = M.m;
+    float det = a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1])
+                - a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0])
+                + a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+    if (det == 0.0f)
+        throw std::invalid_argument("affineInverse: singular transform");
+
+    QMatrix r;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            int j1 = (j + 1) % 3, j2 = (j + 2) % 3, i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+            r.m[i][j] = (a[j1][i1] * a[j2][i2] - a[j1][i2] * a[j2][i1]) / det;
+        }
+    }
+    for (int j = 0; j < 3; j++)
+        r.m[3][j] = -(a[3][0] * r.m[0][j] + a[3][1] * r.m[1][j] + a[3][2] * r.m[2][j]);
+    r.m[3][3] = 1.0f;
+    return r;
+}
+
+// A lokalis z tengely az axis iranyba, az origo az origin pontba kerul, scale-szeresre nagyitva
+inline QMatrix placementMatrix(Point origin, Vector axis, float scale) {
+    Vector ez = axis.normalize(), ex, ey;
+    orthonormalFrame(ez, ex, ey);
+    Vector rows[3] = {ex * scale, ey * scale, ez * scale};
+
+    QMatrix M;
+    for (int i = 0; i < 3; i++) {
+        M.m[i][0] = rows[i].x;
+        M.m[i][1] = rows[i].y;
+        M.m[i][2] = rows[i].z;
+    }
+    M.m[3][0] = origin.x;
+    M.m[3][1] = origin.y;
+    M.m[3][2] = origin.z;
+    M.m[3][3] = 1.0f;
+    return M;
+}
+
+class Model {
+    BVH bvh;
+    AABB box;
+    bool bounded;
+
+public:
+    // A modell objektumainak anyaga nem szamit, a peldany anyagat hasznaljuk; az ObjectStore-nak ettol meg kell egy
+    static const MaterialIndex MATERIAL = 0;
+
+    ObjectStore objects;
+
+    Model() : bounded(false) {
+        objects.addMaterial(Surface());
+    }
+
+    // Az objektumok felvetele utan egyszer, a peldanyositas elott; a tombok a hivo arenajaba kerulnek
+    void build(Arena &arena) {
+        bvh.build(objects, arena);
+        bounded = bvh.bounds(box);
+    }
+
+    bool built() {
+        return bvh.built();
+    }
+
+    // A modell doboza a sajat rendszereben; false, ha vegtelen objektum is van benne
+    bool bounds(AABB &b) {
+        b = box;
+        return bounded;
+    }
+
+    bool intersect(Ray &ray, float &t, ObjectHandle &o) {
+        return bvh.intersect(ray, t, o);
+    }
+};
+
+inline bool ObjectStore::intersectInstance(Instance &instance, Ray &ray, float &t) {
+    Ray local(transformPoint(instance.toLocal, ray.p0), transformDirection(instance.toLocal, ray.v));
+    float tl = FLOAT_MAX;
+    ObjectHandle inner;
+    if (!instance.model->intersect(local, tl, inner))
+        return false;
+    t = tl;
+    return true;
+}
+
+// A talalt belso objektumot a metszes megismetlesevel keressuk meg (ugyanaz a szamitas, ugyanaz az eredmeny), igy
+// a metszesnek nem kell a belso handle-t is visszaadnia; a vegso talalatonkent egyszer fut. A lokalis sugar iranya
+// nincs normalva, igy a parametere ugyanaz, mint a vilagbelie: a keresest t-nel lezarva a tavolabbi reszfak
+// kimaradnak. Ha a talalat mashonnan (pl. a csomagos metszesbol) jott, es t kicsit elter, lezaras nelkul keresunk.
+// A normalis a toWorld inverz transzponaltjaval, vagyis a toLocal 3x3-as reszenek transzponaltjaval transzformalodik.
+inline Vector ObjectStore::instanceNormal(Instance &instance, Ray &ray, float t) {
+    Ray local(transformPoint(instance.toLocal, ray.p0), transformDirection(instance.toLocal, ray.v));
+    float tl = nextafterf(t, FLOAT_MAX);
+    ObjectHandle inner;
+    if (!instance.model->intersect(local, tl, inner)) {
+        tl = FLOAT_MAX;
+        if (!instance.model->intersect(local, tl, inner))
+            return ray.v.negate().normalize();
+    }
+
+    Vector n = instance.model->objects.normalAt(inner, local, tl);
+    const float (*a)[4] = instance.toLocal.m;
+    return Vector(a[0][0] * n.x + a[0][1] * n.y + a[0][2] * n.z,
+                  a[1][0] * n.x + a[1][1] * n.y + a[1][2] * n.z,
+                  a[2][0] * n.x + a[2][1] * n.y + a[2][2] * n.z).normalize();
+}
+
+// A vilagbeli doboz a modell dobozanak nyolc transzformalt csucsabol
+inline void ObjectStore::placeInstance(Instance &instance, QMatrix toWorld) {
+    instance.toWorld = toWorld;
+    instance.toLocal = affineInverse(toWorld);
+    instance.box = AABB();
+
+    AABB local;
+    instance.bounded = instance.model->bounds(local);
+    if (!instance.bounded)
+        return;
+    for (int c = 0; c < 8; c++) {
+        Point corner(c & 1 ? local.pmax.x : local.pmin.x, c & 2 ? local.pmax.y : local.pmin.y,
+                     c & 4 ? local.pmax.z : local.pmin.z);
+        instance.box.grow(transformPoint(toWorld, corner));
+    }
+}
+
+inline ObjectHandle ObjectStore::addInstance(MaterialIndex material, Model *model, QMatrix toWorld) {
+    if (model == NULL || !model->built())
+        throw std::invalid_argument("ObjectStore: instances need a model that is already built");
+    Instance instance;
+    instance.model = model;
+    placeInstance(instance, toWorld);
+    checkAdd(instances.size, material);
+    instances.push(instance);
+    instanceMaterials.push(material);
+    return makeHandle(OBJECT_INSTANCE, instances.size - 1);
+}
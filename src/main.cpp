@@ -65,93 +65,38 @@
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 // Innentol modosithatod...
 #include "imps.cpp"
+#include "framebuffer.cpp"
+#include "scheduler.cpp"
+#include "scene.cpp"
+#include "progressive.cpp"
 #include "../bitmap_image.hpp"
-#include <thread>
 
 const unsigned int screenWidth = 2048 * 4;    // alkalmazás ablak felbontása
 const unsigned int screenHeight = 2048 * 4;
-static const int MAX_THREADS = 8;
+static const unsigned int TILE_SIZE = 32;
+static const int THREADS = 0;                  // 0: std::thread::hardware_concurrency()
+static const int MAX_SAMPLES = 16;             // teljes felbontasu passzok (mintak pixelenkent) szama
 
-Color image[screenWidth * screenHeight];
+ProgressiveRenderer renderer(screenWidth, screenHeight, TILE_SIZE, THREADS, MAX_SAMPLES);
 World *world;
 
-void traceThread(Point eye, Point lookAt, Vector right, Vector up, float scale, unsigned int begin, unsigned int end) {
-    for (unsigned int i = begin; i < end; i++) {
-        unsigned int x = i % screenHeight;
-        unsigned int y = (i - (i % screenHeight)) / screenWidth;
-
-        Point pixel = lookAt + right * (2.0f * x / screenWidth - 1.0f) * scale + up * (2.0f * y / screenHeight - 1.0f) * scale;
-        Ray ray(pixel, (pixel - eye).normalize());
-
-        image[i] = world->trace(ray);
-    }
-}
-
 // Inicializacio, a program futasanak kezdeten, az OpenGL kontextus letrehozasa utan hivodik meg (ld. main() fv.)
 void onInitialization() {
     glViewport(0, 0, screenWidth, screenHeight);
 
-    Surface whitediffuse = Surface(Color(5.0f, 5.0f, 5.0f), Color(), 0.1f, false, false);
-    Surface glass = Surface(Color(), Color(1.5f, 1.5f, 1.5f), 1.0f, true, true);
-    Surface gold = Surface(Color(3.1f, 2.7f, 1.9f), Color(0.17f, 0.35f, 1.5f), 5.0f, false, true);
-    Surface silver = Surface(Color(4.1f, 2.3f, 3.1f), Color(0.14f, 0.16f, 0.13f), 5.0f, false, true);
-
-    world = new World(100, 3, Color(0.5294f, 0.8078f, 0.9215f), Color(0.03f, 0.03f, 0.03f), 10);
-
-    world->lights.push(Light(Point(1.0f, 1.1f, 30.0f), Color(1.0f, 0.0f, 0.0f), 100.0f));
-    world->lights.push(Light(Point(1.1f, 1.1f, 30.0f), Color(0.0f, 1.0f, 0.0f), 100.0f));
-    world->lights.push(Light(Point(1.1f, 1.0f, 30.0f), Color(0.0f, 0.0f, 1.0f), 100.0f));
-
-    world->objects.push(new GroundObject(whitediffuse));
-
-    world->objects.push(new SphereObject(silver, 1.0f, Point(5.0f, 1.0f, 2.5f)));
-    world->objects.push(new SphereObject(glass, 1.0f, Point(1.0f, 1.0f, 2.5f)));
-    world->objects.push(new SphereObject(silver, 1.0f, Point(1.0f, 5.0f, 2.5f)));
-    world->objects.push(new SphereObject(glass, 1.0f, Point(5.0f, 5.0f, 2.5f)));
-
-    world->objects.push(new SphereObject(silver, 1.0f, Point(5.0f, 1.0f, 0.0f)));
-    world->objects.push(new SphereObject(silver, 1.0f, Point(1.0f, 5.0f, 0.0f)));
+    Camera camera;
+    world = createScene("still-life", camera);
 
-
-    world->objects.push(new SphereObject(gold, 1.0f, Point(5.0f, 1.0f, 8.5f)));
-    world->objects.push(new SphereObject(silver, 1.0f, Point(1.0f, 1.0f, 8.5f)));
-    world->objects.push(new SphereObject(gold, 1.0f, Point(1.0f, 5.0f, 8.5f)));
-    world->objects.push(new SphereObject(silver, 1.0f, Point(5.0f, 5.0f, 8.5f)));
-
-    world->objects.push(new SphereObject(silver, 2.0f, Point(8.0f, 8.0f, 4.5f)));
-    world->objects.push(new SphereObject(gold, 2.0f, Point(4.0f, 12.0f, 4.5f)));
-    world->objects.push(new SphereObject(gold, 2.0f, Point(12.0f, 4.0f, 4.5f)));
-
-    world->objects.push(new SphereObject(glass, 1.5f, Point(2.4f, 2.4f, 1.5f)));
-    world->objects.push(new SphereObject(glass, 1.0f, Point(2.4f, 2.4f, 5.5f)));
-
-    Point eye(-20.0f, -20.0f, 5.0f);
-    Point lookAt(-10.0f, -10.0f, 4.5f);
-
-    Vector direction = (lookAt - eye).normalize();
-    Vector right = (direction % Vector(0.0f, 0.0f, 1.0f)).normalize();
-    Vector up = (right % direction).normalize();
-    float scale = 2.5f;
-
-    std::thread *threads[MAX_THREADS];
-    unsigned int pixelPerThread = screenWidth * screenHeight / MAX_THREADS;
-
-    for (int i = 0; i < MAX_THREADS; i++) {
-        unsigned int begin, end;
-        begin = i * pixelPerThread;
-        end = begin + pixelPerThread;
-        threads[i] = new std::thread(traceThread, eye, lookAt, right, up, scale, begin, end);
-    }
-
-    for (int i = 0; i < MAX_THREADS; i++) {
-        (*threads[i]).join();
-    }
+    // A kepet hatterszalak finomitjak, az onIdle rajzoltatja ujra, amint van uj eredmeny
+    renderer.start(world, camera);
 }
 
 // Rajzolas, ha az alkalmazas ablak ervenytelenne valik, akkor ez a fuggveny hivodik meg
 void onDisplay() {
-    // Atmasoljuk a kepet a rasztertarba
-    glDrawPixels(screenWidth, screenHeight, GL_RGB, GL_FLOAT, image);
+    // Atmasoljuk a kepet (az eddigi legjobb becslest) a rasztertarba
+    renderer.withImage([](const Color *pixels, unsigned int width, unsigned int height) {
+        glDrawPixels(width, height, GL_RGB, GL_FLOAT, pixels);
+    });
 
     //    // Majd rajzolunk egy kek haromszoget
     //    glColor3f(0, 0, 1);
@@ -190,7 +135,7 @@ void onMouseMotion(int x, int y) {
 
 // `Idle' esemenykezelo, jelzi, hogy az ido telik, az Idle esemenyek frekvenciajara csak a 0 a garantalt minimalis ertek
 void onIdle() {
-
+    if (renderer.poll()) glutPostRedisplay();
 }
 
 // ...Idaig modosithatod
@@ -0,0 +1,37 @@
+//--------------------------------------------------------
+// MaterialTable
+//--------------------------------------------------------
+// Az anyagok kozos tablaja: az objektumok csak egy 16 bites indexet tarolnak, igy a metszeshez olvasott
+// geometria mellett nem utazik a Surface. Egy anyag atirasa (set) minden objektumra hat, ami hasznalja,
+// a jelenetet vagy a BVH-t nem kell ujraepiteni; renderelesi szalak futasa kozben ne irjuk at.
+// A MAX_MATERIALS-adik utani anyag std::length_error kivetelt dob.
+typedef unsigned short MaterialIndex;
+
+static const int MAX_MATERIALS = 1 << 16;
+
+class MaterialTable {
+    DynamicArray<Surface> surfaces;
+
+public:
+    MaterialIndex add(const Surface &surface) {
+        if (surfaces.size >= MAX_MATERIALS)
+            throw std::length_error("MaterialTable: more than 65536 materials");
+        surfaces.push(surface);
+        return (MaterialIndex) (surfaces.size - 1);
+    }
+
+    // A Surface konstruktora mar kiszamolta a szarmaztatott tagokat, azokat is atvesszuk
+    void set(MaterialIndex index, const Surface &surface) {
+        if (index >= surfaces.size)
+            throw std::out_of_range("MaterialTable: unknown material index");
+        surfaces[index] = surface;
+    }
+
+    Surface &operator[](MaterialIndex index) {
+        return surfaces[index];
+    }
+
+    int size() {
+        return surfaces.size;
+    }
+};
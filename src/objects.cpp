@@ -0,0 +1,769 @@
+//--------------------------------------------------------
+// Geometriai primitivek
+//--------------------------------------------------------
+// Csak az adat, amit a metszes minden tesztnel olvas; az anyag es a BVH-hoz kello doboz kulon tombben van.
+struct Sphere {
+    Point center;
+    float r;
+};
+
+// n * p = d sik
+struct Plane {
+    Vector n;
+    float d;
+};
+
+// Megosztott alapalak a sajat (lokalis) koordinatarendszereben: tengelyallasu ellipszoid, henger vagy paraboloid.
+// Csak a type-nak megfelelo tag ervenyes; alakbol keves van, a peldanyokbol sok.
+struct Shape {
+    ObjectType type;    // OBJECT_QUADRIC, OBJECT_CYLINDER vagy OBJECT_PARABOLOID
+    Quadric quadric;
+    Cylinder cylinder;
+    Paraboloid paraboloid;
+    Point bvP0;
+    float bvR;
+};
+
+// Alakpeldany: a vilagbol a lokalis rendszerbe ((p - origin) * ex, ey, ez) / scale visz. Affin lekepezes, igy a
+// lokalisba vitt, nem normalizalt iranyu sugar parametere ugyanaz a t, mint a vilagban.
+struct Part {
+    Vector ex, ey, ez;    // a lokalis tengelyek a vilagban, ortonormalt, ez a resz tengelye
+    Point origin;
+    float invScale;
+    int shape;
+    Point bvP0;
+    float bvR;
+};
+
+class Model;
+
+// Modell peldanya (instancing): a sugarat a toLocal matrixszal a modell rendszerebe visszuk, ott a modell sajat
+// BVH-ja metsz. Affin lekepezes, a t parameter a ket rendszerben ugyanaz. A matrixok sorvektorosak (p' = p M).
+struct Instance {
+    Model *model;
+    QMatrix toWorld;
+    QMatrix toLocal;
+    AABB box;          // a vilagban
+    bool bounded;      // false, ha a modellben vegtelen objektum (pl. sik) is van
+};
+
+//--------------------------------------------------------
+// ObjectStore
+//--------------------------------------------------------
+// A jelenet objektumai tipusonkent kulon, tomoren pakolt tombokben; az anyagok a kozos MaterialTable-ben,
+// az objektumok anyagindexe parhuzamos tombokben. Virtualis hivas helyett a handle tipusa szerint agazunk el.
+class ObjectStore {
+    DynamicArray<Sphere> spheres;
+    DynamicArray<Quadric> quadrics;
+    DynamicArray<AABB> quadricBoxes;
+    DynamicArray<Plane> planes;
+    DynamicArray<Cylinder> cylinders;
+    DynamicArray<Paraboloid> paraboloids;
+    DynamicArray<Part> parts;
+    DynamicArray<Shape> shapes;
+    DynamicArray<Instance> instances;
+
+    MaterialTable materials;
+    DynamicArray<MaterialIndex> sphereMaterials;
+    DynamicArray<MaterialIndex> quadricMaterials;
+    DynamicArray<MaterialIndex> planeMaterials;
+    DynamicArray<MaterialIndex> cylinderMaterials;
+    DynamicArray<MaterialIndex> paraboloidMaterials;
+    DynamicArray<MaterialIndex> partMaterials;
+    DynamicArray<MaterialIndex> instanceMaterials;
+
+    // A sugar egyenesenek a befoglalo gombtol vett tavolsaga alapjan dont, gyokvonas nelkul
+    static bool intersectBV(Point &p0, float r, Ray &ray) {
+        if (r <= 0.0f) return true;
+
+        Vector l = p0 - ray.p0;
+        Vector d = l - ray.v * ((l * ray.v) / (ray.v * ray.v));
+        if (d * d <= r * r) return true;
+
+        RAY_STAT(bvRejects);
+        return false;
+    }
+
+    // intersectBV savonkent, ugyanabban a muveleti sorrendben, hogy a ket ut bitre azonos eredmenyt adjon
+    static void intersectBVPacket(Point &p0, float r, RayPacket &p, int *pass) {
+        if (r <= 0.0f) {
+            for (int i = 0; i < PACKET_SIZE; i++)
+                pass[i] = p.active[i];
+            return;
+        }
+
+        float r2 = r * r;
+        unsigned long rejects = 0;
+        for (int i = 0; i < PACKET_SIZE; i++) {
+            float lx = p0.x - p.ox[i], ly = p0.y - p.oy[i], lz = p0.z - p.oz[i];
+            float k = (lx * p.dx[i] + ly * p.dy[i] + lz * p.dz[i]) / (p.dx[i] * p.dx[i] + p.dy[i] * p.dy[i] + p.dz[i] * p.dz[i]);
+            float ex = lx - p.dx[i] * k, ey = ly - p.dy[i] * k, ez = lz - p.dz[i] * k;
+            int inside = (ex * ex + ey * ey + ez * ez) <= r2;
+            pass[i] = p.active[i] & inside;
+            rejects += p.active[i] & !inside;
+        }
+        RAY_STAT_ADD(bvRejects, rejects);
+    }
+
+    static bool closestRoot(float a, float b, float c, float &t) {
+        float disc = b * b - 4.0f * a * c;
+
+        if (disc < 0.0f) return false;
+
+        float t1 = (-1.0f * b + sqrtf(disc)) / (2.0f * a);
+        float t2 = (-1.0f * b - sqrtf(disc)) / (2.0f * a);
+
+        t = (t1 < t2) ? t1 : t2;
+        return true;
+    }
+
+    // closestRoot savonkent, tc FLOAT_MAX ha nincs valos gyok
+    static void closestRootPacket(float *a, float *b, float *c, float *tc) {
+        for (int i = 0; i < PACKET_SIZE; i++) {
+            float disc = b[i] * b[i] - 4.0f * a[i] * c[i];
+            float sq = sqrtf(disc > 0.0f ? disc : 0.0f);
+            float t1 = (-1.0f * b[i] + sq) / (2.0f * a[i]);
+            float t2 = (-1.0f * b[i] - sq) / (2.0f * a[i]);
+            tc[i] = disc < 0.0f ? FLOAT_MAX : ((t1 < t2) ? t1 : t2);
+        }
+    }
+
+    static void acceptPacket(RayPacket &p, int *pass, float *tc, ObjectHandle handle) {
+        for (int i = 0; i < PACKET_SIZE; i++) {
+            if (pass[i] && tc[i] > RAY_EPSILON && tc[i] < p.t[i]) {
+                p.t[i] = tc[i];
+                p.object[i] = handle;
+            }
+        }
+    }
+
+    // Szimmetrikus 3x3 matrix legkisebb sajaterteke (trigonometrikus zart alak)
+    static float minEigenvalue(float a[3][3]) {
+        float p1 = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+        float q = (a[0][0] + a[1][1] + a[2][2]) / 3.0f;
+        if (p1 == 0.0f)
+            return minf(a[0][0], minf(a[1][1], a[2][2]));
+
+        float p2 = (a[0][0] - q) * (a[0][0] - q) + (a[1][1] - q) * (a[1][1] - q) + (a[2][2] - q) * (a[2][2] - q) + 2.0f * p1;
+        float p = sqrtf(p2 / 6.0f);
+
+        float b[3][3];
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++)
+                b[i][j] = (a[i][j] - (i == j ? q : 0.0f)) / p;
+
+        float r = (b[0][0] * (b[1][1] * b[2][2] - b[1][2] * b[2][1])
+                   - b[0][1] * (b[1][0] * b[2][2] - b[1][2] * b[2][0])
+                   + b[0][2] * (b[1][0] * b[2][1] - b[1][1] * b[2][0])) / 2.0f;
+        float phi = acosf(maxf(-1.0f, minf(1.0f, r))) / 3.0f;
+
+        return q + 2.0f * p * cosf(phi + 2.0f * (float) M_PI / 3.0f);
+    }
+
+    // x^T A x + 2 b^T x + d = 0 alakbol: kozeppont c = -A^-1 b, (x - c)^T A (x - c) = k,
+    // a doboz fel-elei sqrt(k * A^-1_ii), a befoglalo gomb sugara sqrt(k / lambda_min).
+    // Csak ellipszoidra (pozitiv definit A) ad true-t, a tobbi felulet vegtelen.
+    static bool quadricBounds(QMatrix &Q, Point &center, float &radius, AABB &box) {
+        float a[3][3], b[3];
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++)
+                a[i][j] = (Q.m[i][j] + Q.m[j][i]) * 0.5f;
+            b[i] = (Q.m[i][3] + Q.m[3][i]) * 0.5f;
+        }
+        float d = Q.m[3][3];
+
+        if (a[0][0] < 0.0f) {
+            for (int i = 0; i < 3; i++) {
+                for (int j = 0; j < 3; j++)
+                    a[i][j] = -a[i][j];
+                b[i] = -b[i];
+            }
+            d = -d;
+        }
+
+        float minor2 = a[0][0] * a[1][1] - a[0][1] * a[1][0];
+        float adj[3][3] = {
+                {a[1][1] * a[2][2] - a[1][2] * a[2][1], a[0][2] * a[2][1] - a[0][1] * a[2][2], a[0][1] * a[1][2] - a[0][2] * a[1][1]},
+                {a[1][2] * a[2][0] - a[1][0] * a[2][2], a[0][0] * a[2][2] - a[0][2] * a[2][0], a[0][2] * a[1][0] - a[0][0] * a[1][2]},
+                {a[1][0] * a[2][1] - a[1][1] * a[2][0], a[0][1] * a[2][0] - a[0][0] * a[2][1], a[0][0] * a[1][1] - a[0][1] * a[1][0]}
+        };
+        float det = a[0][0] * adj[0][0] + a[0][1] * adj[1][0] + a[0][2] * adj[2][0];
+
+        if (a[0][0] <= 0.0f || minor2 <= 0.0f || det <= 0.0f)
+            return false;
+
+        float cv[3];
+        for (int i = 0; i < 3; i++)
+            cv[i] = -(adj[i][0] * b[0] + adj[i][1] * b[1] + adj[i][2] * b[2]) / det;
+        Point c(cv[0], cv[1], cv[2]);
+
+        float k = -(d + b[0] * cv[0] + b[1] * cv[1] + b[2] * cv[2]);
+        if (k <= 0.0f)
+            return false;
+
+        Vector e(sqrtf(k * adj[0][0] / det), sqrtf(k * adj[1][1] / det), sqrtf(k * adj[2][2] / det));
+        center = c;
+        radius = sqrtf(k / minEigenvalue(a));
+        box = AABB(Point(c.x - e.x, c.y - e.y, c.z - e.z), c + e);
+        return true;
+    }
+
+    static bool intersectSphere(Sphere &s, Ray &ray, float &t) {
+        if (!intersectBV(s.center, s.r, ray)) return false;
+
+        Vector temp(ray.p0 - s.center);
+
+        float a = ray.v * ray.v;
+        float b = temp * ray.v * 2.0f;
+        float c = temp * temp - (s.r * s.r);
+
+        return closestRoot(a, b, c, t);
+    }
+
+    static bool intersectQuadric(Quadric &q, Ray &ray, float &t) {
+        if (!intersectBV(q.bvP0, q.bvR, ray)) return false;
+
+        float o[3] = {ray.p0.x, ray.p0.y, ray.p0.z}, d[3] = {ray.v.x, ray.v.y, ray.v.z};
+        float a, b, c;
+        quadricCoefficients(q, o, d, a, b, c);
+
+        return closestRoot(a, b, c, t);
+    }
+
+    static bool intersectPlane(Plane &pl, Ray &ray, float &t) {
+        float denom = pl.n * ray.v;
+        if (denom == 0)
+            return false;
+        t = (pl.d - pl.n * ray.p0.vectorFromOrigo()) / denom;
+        return true;
+    }
+
+    // A RAY_EPSILON utani kisebbik gyok, hogy a zart alakot belulrol is eltalaljuk
+    static bool nearestRoot(float a, float b, float c, float &t) {
+        float disc = b * b - 4.0f * a * c;
+        if (disc < 0.0f) return false;
+
+        float sq = sqrtf(disc);
+        float t1 = (-1.0f * b - sq) / (2.0f * a), t2 = (-1.0f * b + sq) / (2.0f * a);
+        float best = FLOAT_MAX;
+        closerHit(minf(t1, t2), best);
+        if (best == FLOAT_MAX)
+            closerHit(maxf(t1, t2), best);
+        t = best;
+        return best < FLOAT_MAX;
+    }
+
+    static Point toLocal(Part &part, Point p) {
+        Vector o = p - part.origin;
+        return Point((o * part.ex) * part.invScale, (o * part.ey) * part.invScale, (o * part.ez) * part.invScale);
+    }
+
+    static Point toWorld(Part &part, Point l) {
+        return part.origin + (part.ex * l.x + part.ey * l.y + part.ez * l.z) * (1.0f / part.invScale);
+    }
+
+    static Vector directionToWorld(Part &part, Vector l) {
+        return part.ex * l.x + part.ey * l.y + part.ez * l.z;
+    }
+
+    // A sugarat az alak lokalis rendszerebe visszuk; a t parameter valtozatlan
+    bool intersectPart(Part &part, Ray &ray, float &t) {
+        if (!intersectBV(part.bvP0, part.bvR, ray)) return false;
+
+        Vector v = ray.v;
+        Ray local(toLocal(part, ray.p0), Vector((v * part.ex) * part.invScale, (v * part.ey) * part.invScale,
+                                                (v * part.ez) * part.invScale));
+        Shape &shape = shapes[part.shape];
+        switch (shape.type) {
+            case OBJECT_CYLINDER:
+                return intersectCylinder(shape.cylinder, local, t);
+            case OBJECT_PARABOLOID:
+                return intersectParaboloid(shape.paraboloid, local, t);
+            default: {
+                float o[3] = {local.p0.x, local.p0.y, local.p0.z}, d[3] = {local.v.x, local.v.y, local.v.z};
+                float a, b, c;
+                quadricCoefficients(shape.quadric, o, d, a, b, c);
+                return nearestRoot(a, b, c, t);
+            }
+        }
+    }
+
+    Vector partNormal(Part &part, Point &p) {
+        Point l = toLocal(part, p);
+        Shape &shape = shapes[part.shape];
+        Vector n;
+        switch (shape.type) {
+            case OBJECT_CYLINDER:
+                n = cylinderNormal(shape.cylinder, l);
+                break;
+            case OBJECT_PARABOLOID:
+                n = paraboloidNormal(shape.paraboloid, l);
+                break;
+            default:
+                n = quadricNormal(shape.quadric, l);
+                break;
+        }
+        return directionToWorld(part, n).normalize();
+    }
+
+    // Pontos doboz: a testet a vilagba visszuk, az ellipszoidnal tengelyenkent sqrt(k sum_i e_ij^2 / q_ii)
+    AABB partBounds(Part &part) {
+        Shape &shape = shapes[part.shape];
+        float scale = 1.0f / part.invScale;
+        switch (shape.type) {
+            case OBJECT_CYLINDER: {
+                Cylinder &c = shape.cylinder;
+                Cylinder w = makeCylinder(toWorld(part, c.base), directionToWorld(part, c.axis), c.r * scale, c.h * scale);
+                return cylinderBounds(w);
+            }
+            case OBJECT_PARABOLOID: {
+                Paraboloid &pb = shape.paraboloid;
+                Paraboloid w = makeParaboloid(toWorld(part, pb.apex), directionToWorld(part, pb.axis),
+                                              sqrtf(pb.k * pb.h) * scale, pb.h * scale);
+                return paraboloidBounds(w);
+            }
+            default: {
+                Quadric &q = shape.quadric;
+                Point c = toWorld(part, q.center);
+                float k = q.kind == QUADRIC_SPHERE ? q.k * q.qxx : q.k;    // gombnel q.k mar osztva van qxx-szel
+                float e[3];
+                for (int j = 0; j < 3; j++)
+                    e[j] = scale * sqrtf(k * (part.ex[j] * part.ex[j] / q.qxx + part.ey[j] * part.ey[j] / q.qyy +
+                                              part.ez[j] * part.ez[j] / q.qzz));
+                return AABB(Point(c.x - e[0], c.y - e[1], c.z - e[2]), Point(c.x + e[0], c.y + e[1], c.z + e[2]));
+            }
+        }
+    }
+
+    // A modell es a BVH definicioja utan, instances.cpp-ben
+    bool intersectInstance(Instance &instance, Ray &ray, float &t);
+    Vector instanceNormal(Instance &instance, Ray &ray, float t);
+    void placeInstance(Instance &instance, QMatrix toWorld);
+
+    // A veges testek savonkent a skalar metszessel; a BVH dobozai miatt ritkan jutnak ide
+    template<class S>
+    static void intersectSolidPacket(S &solid, RayPacket &p, ObjectHandle handle, bool (*hit)(S &, Ray &, float &)) {
+        for (int i = 0; i < PACKET_SIZE; i++) {
+            if (!p.active[i]) continue;
+            Ray ray(Point(p.ox[i], p.oy[i], p.oz[i]), Vector(p.dx[i], p.dy[i], p.dz[i]));
+            float t;
+            if (intersectBV(solid.bvP0, solid.bvR, ray) && hit(solid, ray, t) && t < p.t[i]) {
+                p.t[i] = t;
+                p.object[i] = handle;
+            }
+        }
+    }
+
+    void intersectPartPacket(Part &part, RayPacket &p, ObjectHandle handle) {
+        for (int i = 0; i < PACKET_SIZE; i++) {
+            if (!p.active[i]) continue;
+            Ray ray(Point(p.ox[i], p.oy[i], p.oz[i]), Vector(p.dx[i], p.dy[i], p.dz[i]));
+            float t;
+            if (intersectPart(part, ray, t) && t < p.t[i]) {
+                p.t[i] = t;
+                p.object[i] = handle;
+            }
+        }
+    }
+
+    void intersectInstancePacket(Instance &instance, RayPacket &p, ObjectHandle handle) {
+        for (int i = 0; i < PACKET_SIZE; i++) {
+            if (!p.active[i]) continue;
+            Ray ray(Point(p.ox[i], p.oy[i], p.oz[i]), Vector(p.dx[i], p.dy[i], p.dz[i]));
+            float t;
+            if (intersectInstance(instance, ray, t) && t < p.t[i]) {
+                p.t[i] = t;
+                p.object[i] = handle;
+            }
+        }
+    }
+
+    static void intersectSpherePacket(Sphere &s, RayPacket &p, ObjectHandle handle) {
+        alignas(32) int pass[PACKET_SIZE];
+        alignas(32) float a[PACKET_SIZE], b[PACKET_SIZE], c[PACKET_SIZE], tc[PACKET_SIZE];
+
+        intersectBVPacket(s.center, s.r, p, pass);
+        for (int i = 0; i < PACKET_SIZE; i++) {
+            float tx = p.ox[i] - s.center.x, ty = p.oy[i] - s.center.y, tz = p.oz[i] - s.center.z;
+            a[i] = p.dx[i] * p.dx[i] + p.dy[i] * p.dy[i] + p.dz[i] * p.dz[i];
+            b[i] = (tx * p.dx[i] + ty * p.dy[i] + tz * p.dz[i]) * 2.0f;
+            c[i] = (tx * tx + ty * ty + tz * tz) - (s.r * s.r);
+        }
+        closestRootPacket(a, b, c, tc);
+        acceptPacket(p, pass, tc, handle);
+    }
+
+    template<int K>
+    static void quadricPacket(Quadric &q, RayPacket &p, float *a, float *b, float *c) {
+        for (int i = 0; i < PACKET_SIZE; i++) {
+            float o[3] = {p.ox[i], p.oy[i], p.oz[i]}, d[3] = {p.dx[i], p.dy[i], p.dz[i]};
+            quadricCoefficients<K>(q, o, d, a[i], b[i], c[i]);
+        }
+    }
+
+    // Az osztaly szerinti elagazas a csomagonkent egyszer tortenik, nem savonkent
+    static void intersectQuadricPacket(Quadric &q, RayPacket &p, ObjectHandle handle) {
+        alignas(32) int pass[PACKET_SIZE];
+        alignas(32) float a[PACKET_SIZE], b[PACKET_SIZE], c[PACKET_SIZE], tc[PACKET_SIZE];
+
+        intersectBVPacket(q.bvP0, q.bvR, p, pass);
+        switch (q.kind) {
+            case QUADRIC_SPHERE:
+                quadricPacket<QUADRIC_SPHERE>(q, p, a, b, c);
+                break;
+            case QUADRIC_ELLIPSOID:
+                quadricPacket<QUADRIC_ELLIPSOID>(q, p, a, b, c);
+                break;
+            case QUADRIC_CYLINDER:
+                quadricPacket<QUADRIC_CYLINDER>(q, p, a, b, c);
+                break;
+            case QUADRIC_PARABOLOID:
+                quadricPacket<QUADRIC_PARABOLOID>(q, p, a, b, c);
+                break;
+            default:
+                quadricPacket<QUADRIC_GENERAL>(q, p, a, b, c);
+                break;
+        }
+        closestRootPacket(a, b, c, tc);
+        acceptPacket(p, pass, tc, handle);
+    }
+
+    static void intersectPlanePacket(Plane &pl, RayPacket &p, ObjectHandle handle) {
+        for (int i = 0; i < PACKET_SIZE; i++) {
+            float denom = pl.n.x * p.dx[i] + pl.n.y * p.dy[i] + pl.n.z * p.dz[i];
+            float t = (pl.d - (pl.n.x * p.ox[i] + pl.n.y * p.oy[i] + pl.n.z * p.oz[i])) / denom;
+            if (p.active[i] && denom != 0.0f && t > RAY_EPSILON && t < p.t[i]) {
+                p.t[i] = t;
+                p.object[i] = handle;
+            }
+        }
+    }
+
+    // Betelt handle-tartomany vagy ismeretlen anyag eseten kivetel, a tombok mar nem dobnak el semmit csendben
+    void checkAdd(int count, MaterialIndex material) {
+        if (count > MAX_HANDLE_INDEX)
+            throw std::length_error("ObjectStore: too many objects of one type for a 28 bit handle index");
+        if (material >= materials.size())
+            throw std::out_of_range("ObjectStore: unknown material index");
+    }
+
+public:
+    // Nagy jeleneteknel elore lefoglalhato a hely, hogy betoltes kozben ne kelljen ujrafoglalni
+    void reserve(ObjectType type, int count) {
+        switch (type) {
+            case OBJECT_SPHERE:
+                spheres.reserve(count);
+                sphereMaterials.reserve(count);
+                break;
+            case OBJECT_QUADRIC:
+                quadrics.reserve(count);
+                quadricBoxes.reserve(count);
+                quadricMaterials.reserve(count);
+                break;
+            case OBJECT_PLANE:
+                planes.reserve(count);
+                planeMaterials.reserve(count);
+                break;
+            case OBJECT_CYLINDER:
+                cylinders.reserve(count);
+                cylinderMaterials.reserve(count);
+                break;
+            case OBJECT_PARABOLOID:
+                paraboloids.reserve(count);
+                paraboloidMaterials.reserve(count);
+                break;
+            case OBJECT_PART:
+                parts.reserve(count);
+                partMaterials.reserve(count);
+                break;
+            default:
+                instances.reserve(count);
+                instanceMaterials.reserve(count);
+                break;
+        }
+    }
+
+    MaterialIndex addMaterial(const Surface &surface) {
+        return materials.add(surface);
+    }
+
+    // Minden objektum, ami ezt az anyagot hasznalja, a kovetkezo sugartol mar az ujat latja
+    void setMaterial(MaterialIndex index, const Surface &surface) {
+        materials.set(index, surface);
+    }
+
+    Surface &material(MaterialIndex index) {
+        return materials[index];
+    }
+
+    ObjectHandle addSphere(MaterialIndex material, float r, Point center) {
+        Sphere s;
+        s.center = center;
+        s.r = r;
+        checkAdd(spheres.size, material);
+        spheres.push(s);
+        sphereMaterials.push(material);
+        return makeHandle(OBJECT_SPHERE, spheres.size - 1);
+    }
+
+    ObjectHandle addQuadric(MaterialIndex material, QMatrix Q) {
+        Quadric q = classifyQuadric(Q);
+        AABB box;
+        if (!quadricBounds(Q, q.bvP0, q.bvR, box))
+            q.bvR = 0.0f;
+        checkAdd(quadrics.size, material);
+        quadrics.push(q);
+        quadricBoxes.push(box);
+        quadricMaterials.push(material);
+        return makeHandle(OBJECT_QUADRIC, quadrics.size - 1);
+    }
+
+    ObjectHandle addPlane(MaterialIndex material, Vector n, float d) {
+        Plane pl;
+        pl.n = n;
+        pl.d = d;
+        checkAdd(planes.size, material);
+        planes.push(pl);
+        planeMaterials.push(material);
+        return makeHandle(OBJECT_PLANE, planes.size - 1);
+    }
+
+    // Zart henger a base kozepu also fedolaptol az axis iranyaban h magassagig
+    ObjectHandle addCylinder(MaterialIndex material, Point base, Vector axis, float r, float h) {
+        checkAdd(cylinders.size, material);
+        cylinders.push(makeCylinder(base, axis, r, h));
+        cylinderMaterials.push(material);
+        return makeHandle(OBJECT_CYLINDER, cylinders.size - 1);
+    }
+
+    // Paraboloid az apex csucsbol az axis iranyaban h magassagig, ott r sugaru fedolappal
+    ObjectHandle addParaboloid(MaterialIndex material, Point apex, Vector axis, float r, float h) {
+        checkAdd(paraboloids.size, material);
+        paraboloids.push(makeParaboloid(apex, axis, r, h));
+        paraboloidMaterials.push(material);
+        return makeHandle(OBJECT_PARABOLOID, paraboloids.size - 1);
+    }
+
+    // Alapalakok a peldanyokhoz: a quadricnak tengelyallasu ellipszoidnak (vagy gombnek) kell lennie
+    int addShape(QMatrix Q) {
+        Shape shape;
+        shape.type = OBJECT_QUADRIC;
+        shape.quadric = classifyQuadric(Q);
+        AABB box;
+        if ((shape.quadric.kind != QUADRIC_SPHERE && shape.quadric.kind != QUADRIC_ELLIPSOID) ||
+            !quadricBounds(Q, shape.bvP0, shape.bvR, box))
+            throw std::invalid_argument("ObjectStore: a shape quadric must be an axis aligned ellipsoid");
+        shapes.push(shape);
+        return shapes.size - 1;
+    }
+
+    int addShape(Cylinder c) {
+        Shape shape;
+        shape.type = OBJECT_CYLINDER;
+        shape.cylinder = c;
+        shape.bvP0 = c.bvP0;
+        shape.bvR = c.bvR;
+        shapes.push(shape);
+        return shapes.size - 1;
+    }
+
+    int addShape(Paraboloid pb) {
+        Shape shape;
+        shape.type = OBJECT_PARABOLOID;
+        shape.paraboloid = pb;
+        shape.bvP0 = pb.bvP0;
+        shape.bvR = pb.bvR;
+        shapes.push(shape);
+        return shapes.size - 1;
+    }
+
+    // A shape alak peldanya: a lokalis z tengely az axis iranyba, az origo az origin pontba kerul, scale-szeresre nagyitva
+    ObjectHandle addPart(MaterialIndex material, int shape, Point origin, Vector axis, float scale) {
+        if (shape < 0 || shape >= shapes.size)
+            throw std::out_of_range("ObjectStore: unknown shape index");
+        Part part;
+        part.ez = axis.normalize();
+        orthonormalFrame(part.ez, part.ex, part.ey);
+        part.origin = origin;
+        part.invScale = 1.0f / scale;
+        part.shape = shape;
+        part.bvP0 = toWorld(part, shapes[shape].bvP0);
+        part.bvR = shapes[shape].bvR * scale;
+        checkAdd(parts.size, material);
+        parts.push(part);
+        partMaterials.push(material);
+        return makeHandle(OBJECT_PART, parts.size - 1);
+    }
+
+    // A model (mar felepitett) peldanya, toWorld a modell rendszerebol a vilagba visz; a modell objektumai
+    // helyett a peldany anyagat hasznaljuk, igy ugyanaz a geometria tobb anyaggal is megjelenhet
+    ObjectHandle addInstance(MaterialIndex material, Model *model, QMatrix toWorld);
+
+    // A peldany uj helyre kerul; a BVH-nak eleg ezutan a dobozokat frissiteni (World::refit)
+    void setTransform(ObjectHandle h, QMatrix toWorld) {
+        if (handleType(h) != OBJECT_INSTANCE)
+            throw std::invalid_argument("ObjectStore: only instances can be moved");
+        placeInstance(instances[handleIndex(h)], toWorld);
+    }
+
+    int size() {
+        return spheres.size + quadrics.size + planes.size + cylinders.size + paraboloids.size + parts.size + instances.size;
+    }
+
+    // Az i-edik objektum handle-je, 0 <= i < size(), tipusonkent folytonosan
+    ObjectHandle handle(int i) {
+        if (i < spheres.size) return makeHandle(OBJECT_SPHERE, i);
+        i -= spheres.size;
+        if (i < quadrics.size) return makeHandle(OBJECT_QUADRIC, i);
+        i -= quadrics.size;
+        if (i < planes.size) return makeHandle(OBJECT_PLANE, i);
+        i -= planes.size;
+        if (i < cylinders.size) return makeHandle(OBJECT_CYLINDER, i);
+        i -= cylinders.size;
+        if (i < paraboloids.size) return makeHandle(OBJECT_PARABOLOID, i);
+        i -= paraboloids.size;
+        if (i < parts.size) return makeHandle(OBJECT_PART, i);
+        return makeHandle(OBJECT_INSTANCE, i - parts.size);
+    }
+
+    MaterialIndex materialOf(ObjectHandle h) {
+        int i = handleIndex(h);
+        switch (handleType(h)) {
+            case OBJECT_SPHERE:
+                return sphereMaterials[i];
+            case OBJECT_QUADRIC:
+                return quadricMaterials[i];
+            case OBJECT_PLANE:
+                return planeMaterials[i];
+            case OBJECT_CYLINDER:
+                return cylinderMaterials[i];
+            case OBJECT_PARABOLOID:
+                return paraboloidMaterials[i];
+            case OBJECT_PART:
+                return partMaterials[i];
+            default:
+                return instanceMaterials[i];
+        }
+    }
+
+    Surface &surface(ObjectHandle h) {
+        return materials[materialOf(h)];
+    }
+
+    // A kisebbik gyok (vagy a sik metszespontja), a [RAY_EPSILON, t) ellenorzest a hivo vegzi;
+    // a veges testek, az alak- es modellpeldanyok mar a RAY_EPSILON utani legkozelebbi talalatot adjak
+    bool intersect(ObjectHandle h, Ray &ray, float &t) {
+        int i = handleIndex(h);
+        switch (handleType(h)) {
+            case OBJECT_SPHERE:
+                return intersectSphere(spheres[i], ray, t);
+            case OBJECT_QUADRIC:
+                return intersectQuadric(quadrics[i], ray, t);
+            case OBJECT_PLANE:
+                return intersectPlane(planes[i], ray, t);
+            case OBJECT_CYLINDER: {
+                Cylinder &c = cylinders[i];
+                return intersectBV(c.bvP0, c.bvR, ray) && intersectCylinder(c, ray, t);
+            }
+            case OBJECT_PARABOLOID: {
+                Paraboloid &pb = paraboloids[i];
+                return intersectBV(pb.bvP0, pb.bvR, ray) && intersectParaboloid(pb, ray, t);
+            }
+            case OBJECT_PART:
+                return intersectPart(parts[i], ray, t);
+            default:
+                return intersectInstance(instances[i], ray, t);
+        }
+    }
+
+    void intersectPacket(ObjectHandle h, RayPacket &packet) {
+        int i = handleIndex(h);
+        switch (handleType(h)) {
+            case OBJECT_SPHERE:
+                intersectSpherePacket(spheres[i], packet, h);
+                break;
+            case OBJECT_QUADRIC:
+                intersectQuadricPacket(quadrics[i], packet, h);
+                break;
+            case OBJECT_PLANE:
+                intersectPlanePacket(planes[i], packet, h);
+                break;
+            case OBJECT_CYLINDER:
+                intersectSolidPacket(cylinders[i], packet, h, intersectCylinder);
+                break;
+            case OBJECT_PARABOLOID:
+                intersectSolidPacket(paraboloids[i], packet, h, intersectParaboloid);
+                break;
+            case OBJECT_PART:
+                intersectPartPacket(parts[i], packet, h);
+                break;
+            default:
+                intersectInstancePacket(instances[i], packet, h);
+                break;
+        }
+    }
+
+    // A ray sugar t-nel levo talalatanak normalisa; a peldanyoknal a talalt belso objektumhoz a sugar kell
+    Vector normalAt(ObjectHandle h, Ray &ray, float t) {
+        int i = handleIndex(h);
+        Point p = ray.getPoint(t);
+        switch (handleType(h)) {
+            case OBJECT_SPHERE: {
+                Sphere &s = spheres[i];
+                return ((p - s.center) / s.r).normalize();
+            }
+            case OBJECT_QUADRIC:
+                return quadricNormal(quadrics[i], p);
+            case OBJECT_PLANE:
+                return planes[i].n;
+            case OBJECT_CYLINDER:
+                return cylinderNormal(cylinders[i], p);
+            case OBJECT_PARABOLOID:
+                return paraboloidNormal(paraboloids[i], p);
+            case OBJECT_PART:
+                return partNormal(parts[i], p);
+            default:
+                return instanceNormal(instances[i], ray, t);
+        }
+    }
+
+    // Vegtelen objektumok (sik, nem ellipszoid quadric, ilyet tartalmazo modell peldanya) false-t adnak vissza
+    bool getBounds(ObjectHandle h, AABB &box) {
+        int i = handleIndex(h);
+        switch (handleType(h)) {
+            case OBJECT_SPHERE: {
+                Sphere &s = spheres[i];
+                box = AABB(Point(s.center.x - s.r, s.center.y - s.r, s.center.z - s.r),
+                           Point(s.center.x + s.r, s.center.y + s.r, s.center.z + s.r));
+                return true;
+            }
+            case OBJECT_QUADRIC:
+                if (quadrics[i].bvR <= 0.0f) return false;
+                box = quadricBoxes[i];
+                return true;
+            case OBJECT_PLANE:
+                return false;
+            case OBJECT_CYLINDER:
+                box = cylinderBounds(cylinders[i]);
+                return true;
+            case OBJECT_PARABOLOID:
+                box = paraboloidBounds(paraboloids[i]);
+                return true;
+            case OBJECT_PART:
+                box = partBounds(parts[i]);
+                return true;
+            default:
+                box = instances[i].box;
+                return instances[i].bounded;
+        }
+    }
+
+    // Csak a gombok adnak true-t, ezeket a BVH levelei SphereSet-ben, SIMD-del metszik
+    bool getSphere(ObjectHandle h, Point &center, float &r) {
+        if (handleType(h) != OBJECT_SPHERE) return false;
+        Sphere &s = spheres[handleIndex(h)];
+        center = s.center;
+        r = s.r;
+        return true;
+    }
+};
@@ -0,0 +1,156 @@
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+//--------------------------------------------------------
+// ProgressiveRenderer
+//--------------------------------------------------------
+// Hatterszalon, egymas utani passzokban finomitja a kepet: eloszor 16, 8, 4, 2 pixeles blokkokban
+// (blokkonkent egy sugar), utana teljes felbontasban, passzonkent uj, pixelen belul eltolt mintaval,
+// amiket futo atlagkent gyujt a kepbe. A rajzolo szal a kepet csak a zar alatt olvassa (withImage),
+// a workerek tile-onkent, a zar alatt irjak bele a kesz eredmenyt.
+class ProgressiveRenderer {
+    static const int COARSE_LEVELS = 4;    // 16, 8, 4 es 2 pixeles blokkok
+
+    World *world;
+    Camera camera;
+    unsigned int width, height;
+    unsigned int tileSize;
+    int threads;
+    int maxSamples;
+
+    Framebuffer image;
+    std::mutex lock;
+    std::thread controller;
+    std::atomic<bool> stopping;
+    std::atomic<bool> dirty;
+    std::atomic<int> passes;
+    std::chrono::steady_clock::time_point lastPresent;
+
+    // Halton-sorozat, a teljes felbontasu passzok pixelen beluli eltolasahoz
+    static float halton(int index, int base) {
+        float f = 1.0f, r = 0.0f;
+        while (index > 0) {
+            f /= base;
+            r += f * (index % base);
+            index /= base;
+        }
+        return r;
+    }
+
+    // Blokkonkent egy sugar a blokk sarkaban; a durvabb szinten mar kiszamolt sarkokat a kepbol vesszuk at
+    void coarseTile(const Tile &tile, unsigned int step, Color *pixels, std::vector<Color> &blocks) {
+        unsigned int bw = (tile.x1 - tile.x0 + step - 1) / step, bh = (tile.y1 - tile.y0 + step - 1) / step;
+        blocks.resize(bw * bh);
+
+        for (unsigned int j = 0; j < bh; j++) {
+            for (unsigned int i = 0; i < bw; i++) {
+                unsigned int x = tile.x0 + i * step, y = tile.y0 + j * step;
+                if (step < 16 && x % (2 * step) == 0 && y % (2 * step) == 0) {
+                    blocks[j * bw + i] = pixels[y * width + x];
+                } else {
+                    Ray ray = camera.getRay((float) x, (float) y, width, height);
+                    blocks[j * bw + i] = world->trace(ray);
+                }
+            }
+        }
+
+        std::lock_guard<std::mutex> guard(lock);
+        for (unsigned int y = tile.y0; y < tile.y1; y++) {
+            for (unsigned int x = tile.x0; x < tile.x1; x++)
+                pixels[y * width + x] = blocks[(y - tile.y0) / step * bw + (x - tile.x0) / step];
+        }
+    }
+
+    // A sample-adik minta: az elso eltolas nelkul (ugyanaz, mint a nem progressziv kep), utana atlagolunk
+    void sampleTile(const Tile &tile, int sample, Color *pixels, std::vector<Color> &samples) {
+        unsigned int tw = tile.x1 - tile.x0;
+        samples.resize(tw * (tile.y1 - tile.y0));
+
+        float jx = sample == 0 ? 0.0f : halton(sample, 2), jy = sample == 0 ? 0.0f : halton(sample, 3);
+        traceTile(world, camera, width, height, tile, jx, jy, [&](unsigned int x, unsigned int y, Color &c) {
+            samples[(y - tile.y0) * tw + (x - tile.x0)] = c;
+        });
+
+        float w = 1.0f / (sample + 1);
+        std::lock_guard<std::mutex> guard(lock);
+        for (unsigned int y = tile.y0; y < tile.y1; y++) {
+            for (unsigned int x = tile.x0; x < tile.x1; x++) {
+                Color &p = pixels[y * width + x];
+                Color &c = samples[(y - tile.y0) * tw + (x - tile.x0)];
+                p = sample == 0 ? c : p + (c - p) * w;
+            }
+        }
+    }
+
+    void run() {
+        Color *pixels = image.data();
+        if (pixels == NULL) return;
+
+        std::vector<std::vector<Color>> scratch;    // szalankent egy, a tile-ok es a menetek kozott ujrahasznalva
+        for (int pass = 0; pass < COARSE_LEVELS + maxSamples && !stopping; pass++) {
+            TileScheduler scheduler(width, height, tileSize, threads);
+            scratch.resize((size_t) scheduler.threads());
+            scheduler.run([&](const Tile &tile, int worker) {
+                if (stopping) return;
+                if (pass < COARSE_LEVELS)
+                    coarseTile(tile, 16u >> pass, pixels, scratch[worker]);
+                else
+                    sampleTile(tile, pass - COARSE_LEVELS, pixels, scratch[worker]);
+                dirty = true;
+            });
+            passes++;
+        }
+    }
+
+public:
+    // A tile meret a 16 tobbszorose legyen, hogy a durva blokkok ne logjanak at a tile-ok kozott
+    ProgressiveRenderer(unsigned int width, unsigned int height, unsigned int tileSize = 32, int threads = 0, int maxSamples = 16)
+            : world(NULL), width(width), height(height), tileSize((tileSize + 15) / 16 * 16), threads(threads),
+              maxSamples(maxSamples), image(width, height), stopping(false), dirty(false), passes(0) {
+    }
+
+    void start(World *w, Camera &c) {
+        stop();
+        world = w;
+        camera = c;
+        image.data();    // a rajzolo szal mar a hatterszal indulasa elott lefoglalt kepet lat
+        stopping = false;
+        passes = 0;
+        controller = std::thread([this]() { run(); });
+    }
+
+    // A folyamatban levo tile-ok befejezodnek, ujak mar nem indulnak
+    void stop() {
+        stopping = true;
+        if (controller.joinable())
+            controller.join();
+    }
+
+    int completedPasses() {
+        return passes;
+    }
+
+    // onIdle-bol: true, ha uj eredmeny van es az elozo megjelenites ota eltelt minInterval
+    bool poll(int minIntervalMs = 50) {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now - lastPresent < std::chrono::milliseconds(minIntervalMs) || !dirty.exchange(false))
+            return false;
+        lastPresent = now;
+        return true;
+    }
+
+    // draw(const Color *pixels, width, height) a zar alatt fut, kozben a workerek nem irnak a kepbe
+    template<class F>
+    void withImage(F draw) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (image.allocated())
+            draw(image.data(), width, height);
+    }
+
+    ~ProgressiveRenderer() {
+        stop();
+    }
+};
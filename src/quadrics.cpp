@@ -0,0 +1,164 @@
+//--------------------------------------------------------
+// Quadric
+//--------------------------------------------------------
+// Masodrendu felulet a szimmetrikus matrix 10 egyedi egyutthatojaval:
+//   f(p) = qxx x^2 + qyy y^2 + qzz z^2 + 2 (qxy xy + qxz xz + qyz yz) + 2 (qx x + qy y + qz z) + q0 = 0
+// Letrehozaskor osztalyozzuk; a vegyes tagok nelkuli feluleteket kozepponti alakban taroljuk, igy a metszes
+// a kozepponthoz relativ origobol, csak a nem nulla tagokkal szamol. Az altalanos ut marad a tartalek.
+enum QuadricClass {
+    QUADRIC_SPHERE,        // qxx = qyy = qzz: |p - center|^2 = k
+    QUADRIC_ELLIPSOID,     // csak negyzetes tagok, mind nem nulla (tengelyallasu ellipszoid, hiperboloid)
+    QUADRIC_CYLINDER,      // a w tengely menten nincs sem negyzetes, sem linearis tag
+    QUADRIC_PARABOLOID,    // a w tengely menten csak linearis tag van
+    QUADRIC_GENERAL
+};
+
+struct Quadric {
+    QuadricClass kind;
+    int u, v, w;    // henger es paraboloid: u, v a negyzetes tengelyek, w a tengely
+    float qxx, qyy, qzz, qxy, qxz, qyz, qx, qy, qz, q0;
+    Point center;   // kozepponti alakban: sum q_ii (p_i - center_i)^2 (+ 2 q_w p_w) = k
+    float k;        // gombnel k mar qxx-szel osztva, vagyis a sugar negyzete
+    Point bvP0;
+    float bvR;      // a befoglalo gomb sugara, 0 ha a felulet vegtelen
+};
+
+// A Q matrix szimmetrikus reszebol; a gradiens (es a normalis) is ebbol jon, ahogy (Q + Q^T) p / 2
+inline Quadric classifyQuadric(const QMatrix &Q) {
+    Quadric q;
+    q.qxx = Q.m[0][0];
+    q.qyy = Q.m[1][1];
+    q.qzz = Q.m[2][2];
+    q.qxy = (Q.m[0][1] + Q.m[1][0]) * 0.5f;
+    q.qxz = (Q.m[0][2] + Q.m[2][0]) * 0.5f;
+    q.qyz = (Q.m[1][2] + Q.m[2][1]) * 0.5f;
+    q.qx = (Q.m[0][3] + Q.m[3][0]) * 0.5f;
+    q.qy = (Q.m[1][3] + Q.m[3][1]) * 0.5f;
+    q.qz = (Q.m[2][3] + Q.m[3][2]) * 0.5f;
+    q.q0 = Q.m[3][3];
+    q.u = 0;
+    q.v = 1;
+    q.w = 2;
+    q.k = 0.0f;
+    q.bvR = 0.0f;
+    q.kind = QUADRIC_GENERAL;
+
+    if (q.qxy != 0.0f || q.qxz != 0.0f || q.qyz != 0.0f)
+        return q;
+
+    float diag[3] = {q.qxx, q.qyy, q.qzz}, lin[3] = {q.qx, q.qy, q.qz}, c[3] = {0.0f, 0.0f, 0.0f};
+    int zeros = 0, zeroAxis = -1;
+    float k = -q.q0;
+    for (int i = 0; i < 3; i++) {
+        if (diag[i] == 0.0f) {
+            zeros++;
+            zeroAxis = i;
+        } else {
+            c[i] = -lin[i] / diag[i];
+            k += lin[i] * lin[i] / diag[i];
+        }
+    }
+    if (zeros > 1)
+        return q;
+
+    q.center = Point(c[0], c[1], c[2]);
+    q.k = k;
+    if (zeros == 0) {
+        if (q.qxx == q.qyy && q.qyy == q.qzz) {
+            q.kind = QUADRIC_SPHERE;
+            q.k = k / q.qxx;
+        } else {
+            q.kind = QUADRIC_ELLIPSOID;
+        }
+    } else {
+        q.w = zeroAxis;
+        q.u = zeroAxis == 0 ? 1 : 0;
+        q.v = zeroAxis == 2 ? 1 : 2;
+        q.kind = lin[zeroAxis] == 0.0f ? QUADRIC_CYLINDER : QUADRIC_PARABOLOID;
+    }
+    return q;
+}
+
+// A t-ben masodfoku a t^2 + b t + c = 0 egyutthatoi az o + t d sugarra; K forditasi ideju, igy a
+// csomagos ut savonkenti ciklusaban nincs elagazas
+template<int K>
+inline void quadricCoefficients(const Quadric &q, const float *o, const float *d, float &a, float &b, float &c) {
+    if (K == QUADRIC_SPHERE) {
+        float tx = o[0] - q.center.x, ty = o[1] - q.center.y, tz = o[2] - q.center.z;
+        a = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+        b = (tx * d[0] + ty * d[1] + tz * d[2]) * 2.0f;
+        c = (tx * tx + ty * ty + tz * tz) - q.k;
+    } else if (K == QUADRIC_ELLIPSOID) {
+        float tx = o[0] - q.center.x, ty = o[1] - q.center.y, tz = o[2] - q.center.z;
+        float sx = q.qxx * tx, sy = q.qyy * ty, sz = q.qzz * tz;
+        a = q.qxx * d[0] * d[0] + q.qyy * d[1] * d[1] + q.qzz * d[2] * d[2];
+        b = (sx * d[0] + sy * d[1] + sz * d[2]) * 2.0f;
+        c = (sx * tx + sy * ty + sz * tz) - q.k;
+    } else if (K == QUADRIC_CYLINDER || K == QUADRIC_PARABOLOID) {
+        float qu = (&q.qxx)[q.u], qv = (&q.qxx)[q.v];
+        float tu = o[q.u] - q.center[q.u], tv = o[q.v] - q.center[q.v];
+        float su = qu * tu, sv = qv * tv;
+        a = qu * d[q.u] * d[q.u] + qv * d[q.v] * d[q.v];
+        if (K == QUADRIC_CYLINDER) {
+            b = (su * d[q.u] + sv * d[q.v]) * 2.0f;
+            c = (su * tu + sv * tv) - q.k;
+        } else {
+            float qw = (&q.qx)[q.w];
+            b = (su * d[q.u] + sv * d[q.v] + qw * d[q.w]) * 2.0f;
+            c = (su * tu + sv * tv + qw * o[q.w] * 2.0f) - q.k;
+        }
+    } else {
+        // (Q d) es (Q o) harom sora, a negyedik (homogen) komponens kulon
+        float ax = q.qxx * d[0] + q.qxy * d[1] + q.qxz * d[2];
+        float ay = q.qxy * d[0] + q.qyy * d[1] + q.qyz * d[2];
+        float az = q.qxz * d[0] + q.qyz * d[1] + q.qzz * d[2];
+        float gx = q.qxx * o[0] + q.qxy * o[1] + q.qxz * o[2] + q.qx;
+        float gy = q.qxy * o[0] + q.qyy * o[1] + q.qyz * o[2] + q.qy;
+        float gz = q.qxz * o[0] + q.qyz * o[1] + q.qzz * o[2] + q.qz;
+        a = ax * d[0] + ay * d[1] + az * d[2];
+        b = (gx * d[0] + gy * d[1] + gz * d[2]) * 2.0f;
+        c = gx * o[0] + gy * o[1] + gz * o[2] + (q.qx * o[0] + q.qy * o[1] + q.qz * o[2] + q.q0);
+    }
+}
+
+inline void quadricCoefficients(const Quadric &q, const float *o, const float *d, float &a, float &b, float &c) {
+    switch (q.kind) {
+        case QUADRIC_SPHERE:
+            quadricCoefficients<QUADRIC_SPHERE>(q, o, d, a, b, c);
+            break;
+        case QUADRIC_ELLIPSOID:
+            quadricCoefficients<QUADRIC_ELLIPSOID>(q, o, d, a, b, c);
+            break;
+        case QUADRIC_CYLINDER:
+            quadricCoefficients<QUADRIC_CYLINDER>(q, o, d, a, b, c);
+            break;
+        case QUADRIC_PARABOLOID:
+            quadricCoefficients<QUADRIC_PARABOLOID>(q, o, d, a, b, c);
+            break;
+        default:
+            quadricCoefficients<QUADRIC_GENERAL>(q, o, d, a, b, c);
+            break;
+    }
+}
+
+// A gradiens fele, ugyanazokbol a kozepponti tagokbol, mint a metszes
+inline Vector quadricNormal(const Quadric &q, Point p) {
+    switch (q.kind) {
+        case QUADRIC_SPHERE:
+            return ((p - q.center) * q.qxx).normalize();
+        case QUADRIC_ELLIPSOID:
+            return Vector(q.qxx * (p.x - q.center.x), q.qyy * (p.y - q.center.y), q.qzz * (p.z - q.center.z)).normalize();
+        case QUADRIC_CYLINDER:
+        case QUADRIC_PARABOLOID: {
+            float g[3];
+            g[q.u] = (&q.qxx)[q.u] * (p[q.u] - q.center[q.u]);
+            g[q.v] = (&q.qxx)[q.v] * (p[q.v] - q.center[q.v]);
+            g[q.w] = q.kind == QUADRIC_PARABOLOID ? (&q.qx)[q.w] : 0.0f;
+            return Vector(g[0], g[1], g[2]).normalize();
+        }
+        default:
+            return Vector(q.qxx * p.x + q.qxy * p.y + q.qxz * p.z + q.qx,
+                          q.qxy * p.x + q.qyy * p.y + q.qyz * p.z + q.qy,
+                          q.qxz * p.x + q.qyz * p.y + q.qzz * p.z + q.qz).normalize();
+    }
+}
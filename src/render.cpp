@@ -0,0 +1,271 @@
+//=============================================================================================
+// Fej nelkuli (headless) renderelo: OpenGL/GLUT es X szerver nelkul fut, az eredmenyt fajlba irja.
+//
+// Hasznalat: grafika-render [--width W] [--height H] [--threads N] [--tile S]
+//                           [--scene still-life|spheres|cactus|cactus-instanced] [--objects N] [--output kep.bmp|kep.pfm]
+//                           [--min-throughput F] [--roulette 0|1] [--heatmap tests|traces|time]
+//                           [--bvh sah|lbvh] [--morton-bits 30|63] [--treelets N] [--bvh-width 2|4|8] [--quantize 8|16]
+//
+// --heatmap eseten szin helyett a pixelenkenti koltseg kerul a kepbe: BMP-be a valasztott metrika hamis szinekkel,
+// .pfm-be nyersen mindharom (tesztek, kovetett sugarak, ns a harom csatornan).
+// --bvh lbvh a gyors, Morton-kodos epites, --treelets menetnyi treelet-optimalizalassal; a BVH-t is --threads szal epiti.
+// --bvh-width 4 vagy 8 eseten a binaris fabol osszevont, --quantize bites gyerekdobozos szeles fat jarjuk be.
+//=============================================================================================
+
+#include "imps.cpp"
+#include "framebuffer.cpp"
+#include "scheduler.cpp"
+#include "scene.cpp"
+#include "../bitmap_image.hpp"
+
+#include <stdio.h>
+#include <chrono>
+#include <algorithm>
+#include <new>
+#include <vector>
+
+struct RenderOptions {
+    unsigned int width;
+    unsigned int height;
+    int threads;
+    unsigned int tileSize;
+    const char *scene;
+    int objects;
+    const char *output;
+    float minThroughput;
+    bool roulette;
+    bool heatmap;
+    CostMetric metric;
+    BVHBuildOptions bvh;
+
+    RenderOptions() : width(1024), height(1024), threads(0), tileSize(32), scene("still-life"), objects(1000), output("render.bmp"),
+                      minThroughput(0.001f), roulette(false), heatmap(false), metric(COST_TIME) {
+    }
+};
+
+static void usage() {
+    fprintf(stderr, "usage: grafika-render [--width W] [--height H] [--threads N] [--tile S]\n"
+            "                     [--scene still-life|spheres|cactus|cactus-instanced] [--objects N] [--output file.bmp|file.pfm]\n"
+            "                     [--min-throughput F] [--roulette 0|1] [--heatmap tests|traces|time]\n"
+            "                     [--bvh sah|lbvh] [--morton-bits 30|63] [--treelets N] [--bvh-width 2|4|8] [--quantize 8|16]\n");
+}
+
+static bool parseOptions(int argc, char **argv, RenderOptions &options) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (i + 1 >= argc) return false;
+        const char *value = argv[++i];
+
+        if (strcmp(arg, "--width") == 0) options.width = (unsigned int) atoi(value);
+        else if (strcmp(arg, "--height") == 0) options.height = (unsigned int) atoi(value);
+        else if (strcmp(arg, "--threads") == 0) options.threads = atoi(value);
+        else if (strcmp(arg, "--tile") == 0) options.tileSize = (unsigned int) atoi(value);
+        else if (strcmp(arg, "--scene") == 0) options.scene = value;
+        else if (strcmp(arg, "--objects") == 0) options.objects = atoi(value);
+        else if (strcmp(arg, "--output") == 0) options.output = value;
+        else if (strcmp(arg, "--min-throughput") == 0) options.minThroughput = (float) atof(value);
+        else if (strcmp(arg, "--roulette") == 0) options.roulette = atoi(value) != 0;
+        else if (strcmp(arg, "--heatmap") == 0) {
+            options.heatmap = true;
+            if (strcmp(value, "tests") == 0) options.metric = COST_TESTS;
+            else if (strcmp(value, "traces") == 0) options.metric = COST_TRACES;
+            else if (strcmp(value, "time") == 0) options.metric = COST_TIME;
+            else return false;
+        }
+        else if (strcmp(arg, "--bvh") == 0) {
+            if (strcmp(value, "sah") == 0) options.bvh.builder = BVH_BINNED_SAH;
+            else if (strcmp(value, "lbvh") == 0) options.bvh.builder = BVH_LBVH;
+            else return false;
+        }
+        else if (strcmp(arg, "--morton-bits") == 0) options.bvh.mortonBits = atoi(value);
+        else if (strcmp(arg, "--treelets") == 0) options.bvh.treeletRounds = atoi(value);
+        else if (strcmp(arg, "--bvh-width") == 0) options.bvh.width = atoi(value);
+        else if (strcmp(arg, "--quantize") == 0) options.bvh.quantizationBits = atoi(value);
+        else return false;
+    }
+    options.bvh.threads = options.threads;
+    return options.width > 0 && options.height > 0 && (options.bvh.mortonBits == 30 || options.bvh.mortonBits == 63)
+           && (options.bvh.width == 2 || options.bvh.width == 4 || options.bvh.width == 8)
+           && (options.bvh.quantizationBits == 8 || options.bvh.quantizationBits == 16);
+}
+
+static bool endsWith(const char *s, const char *suffix) {
+    size_t n = strlen(s), m = strlen(suffix);
+    return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+static float clamp01(float f) {
+    return f < 0.0f ? 0.0f : (f > 1.0f ? 1.0f : f);
+}
+
+// 24 bites BMP, a kep also sora van a tomb elejen (ahogy a glDrawPixels is varja)
+static bool saveBitmap(const char *file, Color *image, unsigned int width, unsigned int height) {
+    bitmap_image bitmap(width, height);
+    for (unsigned int y = 0; y < height; y++) {
+        for (unsigned int x = 0; x < width; x++) {
+            Color &c = image[y * width + x];
+            bitmap.set_pixel(x, height - 1 - y,
+                             (unsigned char) (clamp01(c.r) * 255.0f + 0.5f),
+                             (unsigned char) (clamp01(c.g) * 255.0f + 0.5f),
+                             (unsigned char) (clamp01(c.b) * 255.0f + 0.5f));
+        }
+    }
+    bitmap.save_image(file);
+    return true;
+}
+
+// Portable float map: vagatlan, linearis float ertekek, a sorok alulrol felfele
+static bool saveFloatMap(const char *file, Color *image, unsigned int width, unsigned int height) {
+    FILE *f = fopen(file, "wb");
+    if (f == NULL) return false;
+
+    fprintf(f, "PF\n%u %u\n-1.0\n", width, height);
+    bool ok = fwrite(image, sizeof(Color), (size_t) width * height, f) == (size_t) width * height;
+    return fclose(f) == 0 && ok;
+}
+
+// A metrika pixelenkenti ertekei; sorted-be rendezve a 99. percentilis kerul a p99 helyre
+static float costPercentile(float *cost, size_t count, CostMetric metric, std::vector<float> &sorted) {
+    sorted.resize(count);
+    for (size_t i = 0; i < count; i++)
+        sorted[i] = cost[i * COST_METRICS + metric];
+    size_t p99 = count * 99 / 100;
+    std::nth_element(sorted.begin(), sorted.begin() + p99, sorted.end());
+    return sorted[p99];
+}
+
+static void printCosts(float *cost, unsigned int width, unsigned int height) {
+    static const char *names[COST_METRICS] = {"tests", "traces", "time (ns)"};
+    size_t count = (size_t) width * height;
+    std::vector<float> sorted;
+    for (int m = 0; m < COST_METRICS; m++) {
+        double sum = 0.0;
+        float maxCost = 0.0f;
+        for (size_t i = 0; i < count; i++) {
+            sum += cost[i * COST_METRICS + m];
+            maxCost = maxf(maxCost, cost[i * COST_METRICS + m]);
+        }
+        float p99 = costPercentile(cost, count, (CostMetric) m, sorted);
+        printf("%s per pixel: mean %.1f, p99 %.1f, max %.1f\n", names[m], sum / count, p99, maxCost);
+    }
+}
+
+// Hamis szines koltsegterkep: a jet skala teteje a 99. percentilis, igy nehany kiugro pixel nem nyomja el a tobbit
+static bool saveHeatmap(const char *file, float *cost, unsigned int width, unsigned int height, CostMetric metric) {
+    std::vector<float> sorted;
+    float p99 = costPercentile(cost, (size_t) width * height, metric, sorted);
+    float scale = p99 > 0.0f ? 1.0f / p99 : 0.0f;
+
+    bitmap_image bitmap(width, height);
+    for (unsigned int y = 0; y < height; y++) {
+        for (unsigned int x = 0; x < width; x++) {
+            float c = cost[((size_t) y * width + x) * COST_METRICS + metric];
+            const rgb_store &color = jet_colormap[(int) (clamp01(c * scale) * 999.0f)];
+            bitmap.set_pixel(x, height - 1 - y, color.red, color.green, color.blue);
+        }
+    }
+
+    bitmap.save_image(file);
+    return true;
+}
+
+// Haromcsatornas portable float map a nyers koltsegekkel: tesztek, kovetett sugarak, ns
+static bool saveCostMap(const char *file, float *cost, unsigned int width, unsigned int height) {
+    FILE *f = fopen(file, "wb");
+    if (f == NULL) return false;
+
+    size_t count = (size_t) width * height * COST_METRICS;
+    fprintf(f, "PF\n%u %u\n-1.0\n", width, height);
+    bool ok = fwrite(cost, sizeof(float), count, f) == count;
+    return fclose(f) == 0 && ok;
+}
+
+int main(int argc, char **argv) {
+    RenderOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        usage();
+        return 1;
+    }
+
+    Camera camera;
+    World *world;
+    try {
+        world = createScene(options.scene, camera, options.objects, options.bvh);
+    } catch (const std::exception &e) {
+        fprintf(stderr, "could not build scene %s: %s\n", options.scene, e.what());
+        return 1;
+    }
+    if (world == NULL) {
+        fprintf(stderr, "unknown scene: %s\n", options.scene);
+        return 1;
+    }
+    world->setPathPruning(options.minThroughput, options.roulette);
+
+    const BVHBuildStats &bvhStats = world->buildStats();
+    printf("bvh (%s): %d objects, %d nodes (%d leaves), SAH cost %.2f, built in %.1f ms on %d threads\n",
+           bvhStats.builder == BVH_LBVH ? "lbvh" : "sah", bvhStats.primitives, bvhStats.nodes, bvhStats.leaves,
+           bvhStats.sahCost, bvhStats.seconds * 1000.0, bvhStats.threads);
+    if (bvhStats.width > 2)
+        printf("bvh%d: %d wide nodes x %d bytes, plus the binary nodes (packets, refit) %d x %d bytes: %.1f MB in all\n",
+               bvhStats.width, bvhStats.wideNodes, bvhStats.wideNodeBytes, bvhStats.nodes, (int) sizeof(BVHNode),
+               ((double) bvhStats.wideNodes * bvhStats.wideNodeBytes + (double) bvhStats.nodes * sizeof(BVHNode)) / 1e6);
+
+#if !defined(GRAFIKA_STATS)
+    if (options.heatmap)
+        fprintf(stderr, "warning: built without GRAFIKA_STATS, only the time metric is recorded\n");
+#endif
+
+    // Hoterkep modban a szines kep helyett pixelenkent egy float koltseg keszul
+    Framebuffer framebuffer(options.heatmap ? 0 : options.width, options.heatmap ? 0 : options.height);
+    Color *image = framebuffer.data();
+    float *cost = options.heatmap ? new(std::nothrow) float[(size_t) options.width * options.height * COST_METRICS] : NULL;
+    if (image == NULL && cost == NULL) {
+        fprintf(stderr, "could not allocate a %ux%u framebuffer\n", options.width, options.height);
+        delete world;
+        return 1;
+    }
+
+    TileScheduler scheduler(options.width, options.height, options.tileSize, options.threads);
+    RayStats *workerStats = new RayStats[scheduler.threads()];
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    scheduler.run([&](const Tile &tile, int worker) {
+        if (cost != NULL)
+            renderTileCost(world, camera, cost, options.width, options.height, tile);
+        else
+            renderTile(world, camera, image, options.width, options.height, tile);
+        RayStats::collect(workerStats[worker]);
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%s %ux%u, %d threads: %.3f s\n", options.scene, options.width, options.height, scheduler.threads(), seconds);
+
+#if defined(GRAFIKA_STATS)
+    RayStats stats;
+    for (int i = 0; i < scheduler.threads(); i++)
+        stats.merge(workerStats[i]);
+    stats.print(stdout, seconds);
+#endif
+    delete[] workerStats;
+
+    bool saved;
+    if (cost != NULL) {
+        printCosts(cost, options.width, options.height);
+        saved = endsWith(options.output, ".pfm")
+                ? saveCostMap(options.output, cost, options.width, options.height)
+                : saveHeatmap(options.output, cost, options.width, options.height, options.metric);
+    } else {
+        saved = endsWith(options.output, ".pfm")
+                ? saveFloatMap(options.output, image, options.width, options.height)
+                : saveBitmap(options.output, image, options.width, options.height);
+    }
+
+    framebuffer.release();
+    delete[] cost;
+    delete world;
+
+    if (!saved) {
+        fprintf(stderr, "could not write %s\n", options.output);
+        return 1;
+    }
+    return 0;
+}
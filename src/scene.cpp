@@ -0,0 +1,191 @@
+#include <string.h>
+#include <chrono>
+
+#include "cactus.cpp"
+
+//--------------------------------------------------------
+// Jelenetek
+//--------------------------------------------------------
+// A GLUT-os es a fej nelkuli program is innen epiti fel a vilagot es a kamerat.
+
+World *createStillLife(Camera &camera, const BVHBuildOptions &bvh) {
+    World *world = new World(Color(0.5294f, 0.8078f, 0.9215f), Color(0.03f, 0.03f, 0.03f), 10);
+
+    MaterialIndex whitediffuse = world->objects.addMaterial(Surface(Color(5.0f, 5.0f, 5.0f), Color(), 0.1f, false, false));
+    MaterialIndex glass = world->objects.addMaterial(Surface(Color(), Color(1.5f, 1.5f, 1.5f), 1.0f, true, true));
+    MaterialIndex gold = world->objects.addMaterial(Surface(Color(3.1f, 2.7f, 1.9f), Color(0.17f, 0.35f, 1.5f), 5.0f, false, true));
+    MaterialIndex silver = world->objects.addMaterial(Surface(Color(4.1f, 2.3f, 3.1f), Color(0.14f, 0.16f, 0.13f), 5.0f, false, true));
+
+    world->lights.push(Light(Point(1.0f, 1.1f, 30.0f), Color(1.0f, 0.0f, 0.0f), 100.0f));
+    world->lights.push(Light(Point(1.1f, 1.1f, 30.0f), Color(0.0f, 1.0f, 0.0f), 100.0f));
+    world->lights.push(Light(Point(1.1f, 1.0f, 30.0f), Color(0.0f, 0.0f, 1.0f), 100.0f));
+
+    world->objects.addPlane(whitediffuse, Vector(0.0f, 0.0f, 1.0f), 0.0f);
+
+    world->objects.addSphere(silver, 1.0f, Point(5.0f, 1.0f, 2.5f));
+    world->objects.addSphere(glass, 1.0f, Point(1.0f, 1.0f, 2.5f));
+    world->objects.addSphere(silver, 1.0f, Point(1.0f, 5.0f, 2.5f));
+    world->objects.addSphere(glass, 1.0f, Point(5.0f, 5.0f, 2.5f));
+
+    world->objects.addSphere(silver, 1.0f, Point(5.0f, 1.0f, 0.0f));
+    world->objects.addSphere(silver, 1.0f, Point(1.0f, 5.0f, 0.0f));
+
+
+    world->objects.addSphere(gold, 1.0f, Point(5.0f, 1.0f, 8.5f));
+    world->objects.addSphere(silver, 1.0f, Point(1.0f, 1.0f, 8.5f));
+    world->objects.addSphere(gold, 1.0f, Point(1.0f, 5.0f, 8.5f));
+    world->objects.addSphere(silver, 1.0f, Point(5.0f, 5.0f, 8.5f));
+
+    world->objects.addSphere(silver, 2.0f, Point(8.0f, 8.0f, 4.5f));
+    world->objects.addSphere(gold, 2.0f, Point(4.0f, 12.0f, 4.5f));
+    world->objects.addSphere(gold, 2.0f, Point(12.0f, 4.0f, 4.5f));
+
+    world->objects.addSphere(glass, 1.5f, Point(2.4f, 2.4f, 1.5f));
+    world->objects.addSphere(glass, 1.0f, Point(2.4f, 2.4f, 5.5f));
+
+    world->build(bvh);
+
+    camera = Camera(Point(-20.0f, -20.0f, 5.0f), Point(-10.0f, -10.0f, 4.5f), 2.5f);
+    return world;
+}
+
+// Skalazasi meresekhez: count darab kis gomb egy racson a csendelet mogott
+World *createSphereField(Camera &camera, int count, const BVHBuildOptions &bvh) {
+    World *world = new World(Color(0.5294f, 0.8078f, 0.9215f), Color(0.03f, 0.03f, 0.03f), 10);
+    world->objects.reserve(OBJECT_SPHERE, count);
+
+    MaterialIndex whitediffuse = world->objects.addMaterial(Surface(Color(5.0f, 5.0f, 5.0f), Color(), 0.1f, false, false));
+    MaterialIndex gold = world->objects.addMaterial(Surface(Color(3.1f, 2.7f, 1.9f), Color(0.17f, 0.35f, 1.5f), 5.0f, false, true));
+    MaterialIndex silver = world->objects.addMaterial(Surface(Color(4.1f, 2.3f, 3.1f), Color(0.14f, 0.16f, 0.13f), 5.0f, false, true));
+
+    world->lights.push(Light(Point(1.0f, 1.1f, 30.0f), Color(1.0f, 0.0f, 0.0f), 100.0f));
+    world->lights.push(Light(Point(1.1f, 1.1f, 30.0f), Color(0.0f, 1.0f, 0.0f), 100.0f));
+    world->lights.push(Light(Point(1.1f, 1.0f, 30.0f), Color(0.0f, 0.0f, 1.0f), 100.0f));
+
+    world->objects.addPlane(whitediffuse, Vector(0.0f, 0.0f, 1.0f), 0.0f);
+
+    int side = (int) ceilf(sqrtf((float) count));
+    float spacing = 20.0f / side;
+    for (int i = 0; i < count; i++) {
+        float x = (i % side) * spacing, y = (i / side) * spacing;
+        world->objects.addSphere(i % 2 ? gold : silver, spacing * 0.4f, Point(x, y, spacing * 0.4f));
+    }
+
+    world->build(bvh);
+
+    camera = Camera(Point(-20.0f, -20.0f, 5.0f), Point(-10.0f, -10.0f, 4.5f), 2.5f);
+    return world;
+}
+
+// Arany ellipszoid, ezust paraboloid es uveg henger kaktusz az asztalon, osszesen legfeljebb partCount reszbol;
+// instanced eseten a reszfak megosztott modellek peldanyai
+World *createCactusGarden(Camera &camera, int partCount, bool instanced, const BVHBuildOptions &bvh) {
+    World *world = new World(Color(0.5294f, 0.8078f, 0.9215f), Color(0.03f, 0.03f, 0.03f), 10);
+
+    MaterialIndex whitediffuse = world->objects.addMaterial(Surface(Color(5.0f, 5.0f, 5.0f), Color(), 0.1f, false, false));
+    MaterialIndex glass = world->objects.addMaterial(Surface(Color(), Color(1.5f, 1.5f, 1.5f), 1.0f, true, true));
+    MaterialIndex gold = world->objects.addMaterial(Surface(Color(3.1f, 2.7f, 1.9f), Color(0.17f, 0.35f, 1.5f), 5.0f, false, true));
+    MaterialIndex silver = world->objects.addMaterial(Surface(Color(4.1f, 2.3f, 3.1f), Color(0.14f, 0.16f, 0.13f), 5.0f, false, true));
+
+    world->lights.push(Light(Point(1.0f, 1.1f, 30.0f), Color(1.0f, 0.0f, 0.0f), 100.0f));
+    world->lights.push(Light(Point(1.1f, 1.1f, 30.0f), Color(0.0f, 1.0f, 0.0f), 100.0f));
+    world->lights.push(Light(Point(1.1f, 1.0f, 30.0f), Color(0.0f, 0.0f, 1.0f), 100.0f));
+
+    world->objects.addPlane(whitediffuse, Vector(0.0f, 0.0f, 1.0f), 0.0f);
+
+    int perCactus = partCount / 3 > 1 ? partCount / 3 : 1;
+    CactusGenerator goldCactus(CACTUS_ELLIPSOID, 1.0f, 5.0f, 5, 0.4f, 1);
+    CactusGenerator silverCactus(CACTUS_PARABOLOID, 1.2f, 5.0f, 5, 0.4f, 2);
+    CactusGenerator glassCactus(CACTUS_CYLINDER, 0.7f, 4.0f, 5, 0.4f, 3);
+    if (instanced) {
+        addInstancedCactus(*world, gold, goldCactus, Point(-1.0f, 6.0f, 0.0f), perCactus);
+        addInstancedCactus(*world, silver, silverCactus, Point(6.0f, -1.0f, 0.0f), perCactus);
+        addInstancedCactus(*world, glass, glassCactus, Point(1.0f, 1.0f, 0.0f), perCactus);
+    } else {
+        addCactus(world->objects, gold, goldCactus, Point(-1.0f, 6.0f, 0.0f), perCactus);
+        addCactus(world->objects, silver, silverCactus, Point(6.0f, -1.0f, 0.0f), perCactus);
+        addCactus(world->objects, glass, glassCactus, Point(1.0f, 1.0f, 0.0f), perCactus);
+    }
+
+    world->build(bvh);
+
+    camera = Camera(Point(-20.0f, -20.0f, 5.0f), Point(-10.0f, -10.0f, 4.5f), 2.5f);
+    return world;
+}
+
+// name: "still-life", "spheres", "cactus" vagy "cactus-instanced", NULL ha nincs ilyen jelenet
+World *createScene(const char *name, Camera &camera, int objectCount = 1000,
+                   const BVHBuildOptions &bvh = BVHBuildOptions()) {
+    if (strcmp(name, "still-life") == 0)
+        return createStillLife(camera, bvh);
+    if (strcmp(name, "spheres") == 0)
+        return createSphereField(camera, objectCount, bvh);
+    if (strcmp(name, "cactus") == 0)
+        return createCactusGarden(camera, objectCount, false, bvh);
+    if (strcmp(name, "cactus-instanced") == 0)
+        return createCactusGarden(camera, objectCount, true, bvh);
+    return NULL;
+}
+
+// A tile-t 4x2-es blokkokban, sugarcsomagokkal kovetjuk; a szelso, csonka blokkokban a felesleges savok inaktivak.
+// (jx, jy) pixelen beluli eltolas, store(x, y, color) minden pixelre egyszer hivodik.
+template<class F>
+void traceTile(World *world, Camera &camera, unsigned int width, unsigned int height, const Tile &tile, float jx, float jy,
+               F store) {
+    const unsigned int BLOCK_W = 4, BLOCK_H = PACKET_SIZE / 4;
+
+    for (unsigned int by = tile.y0; by < tile.y1; by += BLOCK_H) {
+        for (unsigned int bx = tile.x0; bx < tile.x1; bx += BLOCK_W) {
+            RayPacket packet;
+            for (int i = 0; i < PACKET_SIZE; i++) {
+                unsigned int x = bx + i % BLOCK_W, y = by + i / BLOCK_W;
+                if (x >= tile.x1 || y >= tile.y1) continue;
+                Ray ray = camera.getRay((float) x + jx, (float) y + jy, width, height);
+                packet.set(i, ray);
+            }
+
+            Color colors[PACKET_SIZE];
+            world->tracePacket(packet, colors);
+
+            for (int i = 0; i < PACKET_SIZE; i++) {
+                if (packet.active[i])
+                    store(bx + i % BLOCK_W, by + i / BLOCK_W, colors[i]);
+            }
+        }
+    }
+}
+
+void renderTile(World *world, Camera &camera, Color *image, unsigned int width, unsigned int height, const Tile &tile) {
+    traceTile(world, camera, width, height, tile, 0.0f, 0.0f, [=](unsigned int x, unsigned int y, Color &c) {
+        image[x + y * width] = c;
+    });
+}
+
+// A hoterkep-mod metrikai: pixelenkent ennyibe kerult a kep. Mindharom rogzul, pixelenkent egymas utan
+// (cost[pixel * COST_METRICS + metrika]), a kimenetnel lehet valasztani kozuluk.
+enum CostMetric {
+    COST_TESTS,     // sugar-objektum metszestesztek (GRAFIKA_STATS kell hozza)
+    COST_TRACES,    // kovetett sugarak, azaz trace/integrate lepesek (GRAFIKA_STATS kell hozza)
+    COST_TIME,      // nanoszekundum
+    COST_METRICS
+};
+
+// Pixelenkent skalar sugarral kovet, hogy a koltseg egyetlen pixelhez legyen rendelheto
+void renderTileCost(World *world, Camera &camera, float *cost, unsigned int width, unsigned int height, const Tile &tile) {
+    const RayStats &stats = RayStats::current();
+
+    for (unsigned int y = tile.y0; y < tile.y1; y++) {
+        for (unsigned int x = tile.x0; x < tile.x1; x++) {
+            unsigned long tests = stats.intersectionTests, traces = stats.tracedRays();
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+            Ray ray = camera.getRay((float) x, (float) y, width, height);
+            world->trace(ray);
+
+            float *c = cost + ((size_t) y * width + x) * COST_METRICS;
+            c[COST_TIME] = (float) std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            c[COST_TESTS] = (float) (stats.intersectionTests - tests);
+            c[COST_TRACES] = (float) (stats.tracedRays() - traces);
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#include <thread>
+#include <mutex>
+#include <deque>
+
+//--------------------------------------------------------
+// Tile
+//--------------------------------------------------------
+struct Tile {
+    unsigned int x0, y0, x1, y1;
+
+    Tile() : x0(0), y0(0), x1(0), y1(0) {
+    }
+
+    Tile(unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1) : x0(x0), y0(y0), x1(x1), y1(y1) {
+    }
+};
+
+//--------------------------------------------------------
+// TileScheduler
+//--------------------------------------------------------
+// A kepet tile-okra bontja, minden szal sajat sorbol dolgozik, ha az kiurult, mas szalaktol lop.
+class TileScheduler {
+    struct WorkerQueue {
+        std::mutex lock;
+        std::deque<Tile> tiles;
+    };
+
+    unsigned int width, height;
+    unsigned int tileSize;
+    int threadCount;
+    WorkerQueue *queues;
+
+    TileScheduler(const TileScheduler &) = delete;
+    TileScheduler &operator=(const TileScheduler &) = delete;
+
+    // A sajat sor vegerol veszunk (az a legutobb kiosztott, kepben szomszedos tile)
+    bool pop(int worker, Tile &tile) {
+        WorkerQueue &q = queues[worker];
+        std::lock_guard<std::mutex> guard(q.lock);
+        if (q.tiles.empty()) return false;
+        tile = q.tiles.back();
+        q.tiles.pop_back();
+        return true;
+    }
+
+    // Lopni a masik sor elejerol lehet, igy a ket fel ritkan versenyez ugyanazert a tile-ert
+    bool steal(int worker, Tile &tile) {
+        for (int i = 1; i < threadCount; i++) {
+            WorkerQueue &q = queues[(worker + i) % threadCount];
+            std::lock_guard<std::mutex> guard(q.lock);
+            if (q.tiles.empty()) continue;
+            tile = q.tiles.front();
+            q.tiles.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    template<class F>
+    void work(int worker, F &render) {
+        Tile tile;
+        while (pop(worker, tile) || steal(worker, tile)) {
+            render(tile, worker);
+        }
+    }
+
+public:
+    TileScheduler(unsigned int width, unsigned int height, unsigned int tileSize = 32, int threads = 0)
+            : width(width), height(height), tileSize(tileSize > 0 ? tileSize : 1), threadCount(threads) {
+        if (threadCount <= 0)
+            threadCount = (int) std::thread::hardware_concurrency();
+        if (threadCount <= 0)
+            threadCount = 1;
+        queues = new WorkerQueue[threadCount];
+    }
+
+    int threads() {
+        return threadCount;
+    }
+
+    // render(const Tile &, int worker) minden tile-ra pontosan egyszer hivodik, a hivo szal is dolgozik
+    template<class F>
+    void run(F render) {
+        unsigned int tilesX = (width + tileSize - 1) / tileSize;
+        unsigned int tilesY = (height + tileSize - 1) / tileSize;
+        unsigned int tileCount = tilesX * tilesY;
+
+        // Egybefuggo savok szalankent, a kiegyenlitest a lopas vegzi
+        for (unsigned int i = 0; i < tileCount; i++) {
+            unsigned int tx = i % tilesX, ty = i / tilesX;
+            Tile tile(tx * tileSize, ty * tileSize, tx * tileSize + tileSize, ty * tileSize + tileSize);
+            if (tile.x1 > width) tile.x1 = width;
+            if (tile.y1 > height) tile.y1 = height;
+            queues[(unsigned long) i * threadCount / tileCount].tiles.push_back(tile);
+        }
+
+        std::thread **threads = new std::thread *[threadCount];
+        for (int i = 1; i < threadCount; i++) {
+            threads[i] = new std::thread([this, i, &render]() { work(i, render); });
+        }
+        work(0, render);
+
+        for (int i = 1; i < threadCount; i++) {
+            threads[i]->join();
+            delete threads[i];
+        }
+        delete[] threads;
+    }
+
+    ~TileScheduler() {
+        delete[] queues;
+    }
+};
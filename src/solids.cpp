@@ -0,0 +1,197 @@
+//--------------------------------------------------------
+// Veges testek: henger es paraboloid
+//--------------------------------------------------------
+// Tetszoleges allasu, zart testek a sajat tengelyuk menten levagva (fedolapokkal), igy pontos, veges AABB-juk
+// van es a BVH-ba kerulhetnek. A metszes a RAY_EPSILON utani legkozelebbi talalatot adja, belulrol is, hogy a
+// toresi sugar a kilepesnel is eltalalja a testet; a normalis mindig kifele mutat.
+
+// Ha tc a (RAY_EPSILON, best) intervallumba esik, ez lesz az uj legkozelebbi talalat
+inline void closerHit(float tc, float &best) {
+    if (tc > RAY_EPSILON && tc < best)
+        best = tc;
+}
+
+// Tengely iranyu egysegvektor i-edik komponensebol: a tengelyre meroleges sik egysegvektorainak
+// legnagyobb i-edik komponense
+inline float perpendicularReach(float ai) {
+    return sqrtf(maxf(0.0f, 1.0f - ai * ai));
+}
+
+// Az axis egysegvektorra meroleges e1, e2 egysegvektorok, (e1, e2, axis) jobbsodrasu
+inline void orthonormalFrame(Vector axis, Vector &e1, Vector &e2) {
+    Vector helper = fabsf(axis.x) < 0.9f ? Vector(1.0f, 0.0f, 0.0f) : Vector(0.0f, 1.0f, 0.0f);
+    e1 = (helper % axis).normalize();
+    e2 = axis % e1;
+}
+
+// Henger: a base kozepu also fedolaptol h magassagig, r sugarral
+struct Cylinder {
+    Point base;
+    Vector axis;    // egysegvektor
+    float r, h;
+    Point bvP0;
+    float bvR;
+};
+
+inline Cylinder makeCylinder(Point base, Vector axis, float r, float h) {
+    Cylinder c;
+    c.base = base;
+    c.axis = axis.normalize();
+    c.r = r;
+    c.h = h;
+    c.bvP0 = base + c.axis * (h * 0.5f);
+    c.bvR = sqrtf(h * h * 0.25f + r * r);
+    return c;
+}
+
+inline bool intersectCylinder(Cylinder &c, Ray &ray, float &t) {
+    Vector o = ray.p0 - c.base;
+    float os = o * c.axis, ds = ray.v * c.axis;
+    Vector op = o - c.axis * os, dp = ray.v - c.axis * ds;
+    float best = FLOAT_MAX;
+
+    // Palast: a tengelyre meroleges komponensek tavolsaga r, csak a ket fedolap kozott
+    float a = dp * dp;
+    if (a > 0.0f) {
+        float b = (op * dp) * 2.0f, cc = op * op - c.r * c.r;
+        float disc = b * b - 4.0f * a * cc;
+        if (disc >= 0.0f) {
+            float sq = sqrtf(disc);
+            float t1 = (-1.0f * b - sq) / (2.0f * a), t2 = (-1.0f * b + sq) / (2.0f * a);
+            float s1 = os + t1 * ds, s2 = os + t2 * ds;
+            if (s1 >= 0.0f && s1 <= c.h) closerHit(t1, best);
+            if (s2 >= 0.0f && s2 <= c.h) closerHit(t2, best);
+        }
+    }
+
+    // Fedolapok
+    if (ds != 0.0f) {
+        float r2 = c.r * c.r;
+        float t0 = (0.0f - os) / ds, th = (c.h - os) / ds;
+        Vector q0 = op + dp * t0, qh = op + dp * th;
+        if (q0 * q0 <= r2) closerHit(t0, best);
+        if (qh * qh <= r2) closerHit(th, best);
+    }
+
+    if (best == FLOAT_MAX)
+        return false;
+    t = best;
+    return true;
+}
+
+// A palast es a ket fedolap kozul ahhoz tartozik a normalis, amelyikhez p a legkozelebb van
+inline Vector cylinderNormal(Cylinder &c, Point &p) {
+    Vector o = p - c.base;
+    float s = o * c.axis;
+    Vector radial = o - c.axis * s;
+    float rho = radial.length();
+
+    float side = fabsf(rho - c.r), bottom = fabsf(s), top = fabsf(s - c.h);
+    if (side <= bottom && side <= top && rho > 0.0f)
+        return radial / rho;
+    return bottom < top ? c.axis.negate() : c.axis;
+}
+
+// Pontos doboz: a ket fedolap korlapjanak dobozai egyutt
+inline AABB cylinderBounds(Cylinder &c) {
+    Point top = c.base + c.axis * c.h;
+    float lo[3], hi[3];
+    for (int i = 0; i < 3; i++) {
+        float e = c.r * perpendicularReach(c.axis[i]);
+        lo[i] = minf(c.base[i], top[i]) - e;
+        hi[i] = maxf(c.base[i], top[i]) + e;
+    }
+    return AABB(Point(lo[0], lo[1], lo[2]), Point(hi[0], hi[1], hi[2]));
+}
+
+// Paraboloid: az apex csucsbol a tengely menten, |p_meroleges|^2 = k s, 0 <= s <= h, s = h-nal fedolappal;
+// a fedolap sugara R = sqrt(k h)
+struct Paraboloid {
+    Point apex;
+    Vector axis;    // egysegvektor, a csucstol a fedolap fele
+    float k, h;
+    Point bvP0;
+    float bvR;
+};
+
+inline Paraboloid makeParaboloid(Point apex, Vector axis, float r, float h) {
+    Paraboloid p;
+    p.apex = apex;
+    p.axis = axis.normalize();
+    p.k = r * r / h;
+    p.h = h;
+    p.bvP0 = apex + p.axis * (h * 0.5f);
+    p.bvR = sqrtf(h * h * 0.25f + r * r);
+    return p;
+}
+
+inline bool intersectParaboloid(Paraboloid &pb, Ray &ray, float &t) {
+    Vector o = ray.p0 - pb.apex;
+    float os = o * pb.axis, ds = ray.v * pb.axis;
+    Vector op = o - pb.axis * os, dp = ray.v - pb.axis * ds;
+    float best = FLOAT_MAX;
+
+    // Palast: |op + t dp|^2 = k (os + t ds); tengellyel parhuzamos sugarnal elsofoku
+    float a = dp * dp, b = (op * dp) * 2.0f - pb.k * ds, cc = op * op - pb.k * os;
+    if (a > 0.0f) {
+        float disc = b * b - 4.0f * a * cc;
+        if (disc >= 0.0f) {
+            float sq = sqrtf(disc);
+            float t1 = (-1.0f * b - sq) / (2.0f * a), t2 = (-1.0f * b + sq) / (2.0f * a);
+            float s1 = os + t1 * ds, s2 = os + t2 * ds;
+            if (s1 >= 0.0f && s1 <= pb.h) closerHit(t1, best);
+            if (s2 >= 0.0f && s2 <= pb.h) closerHit(t2, best);
+        }
+    } else if (b != 0.0f) {
+        float t1 = -cc / b, s1 = os + t1 * ds;
+        if (s1 >= 0.0f && s1 <= pb.h) closerHit(t1, best);
+    }
+
+    // Fedolap
+    if (ds != 0.0f) {
+        float th = (pb.h - os) / ds;
+        Vector qh = op + dp * th;
+        if (qh * qh <= pb.k * pb.h) closerHit(th, best);
+    }
+
+    if (best == FLOAT_MAX)
+        return false;
+    t = best;
+    return true;
+}
+
+// A palast normalisa a |p_meroleges|^2 - k s fuggveny gradiense; a fedolapet a tavolsagok alapjan valasztjuk
+inline Vector paraboloidNormal(Paraboloid &pb, Point &p) {
+    Vector o = p - pb.apex;
+    float s = o * pb.axis;
+    Vector radial = o - pb.axis * s;
+    Vector gradient = radial * 2.0f - pb.axis * pb.k;
+
+    float side = fabsf(radial * radial - pb.k * s) / gradient.length(), top = fabsf(s - pb.h);
+    if (top < side)
+        return pb.axis;
+    return gradient.normalize();
+}
+
+// max (ai s + m R sqrt(s / h)), 0 <= s <= h: a vegpontokban, vagy ha ai < 0, a derivalt gyokeben
+inline float paraboloidReach(float ai, float m, float R, float h) {
+    float best = maxf(0.0f, ai * h + m * R);
+    if (ai < 0.0f) {
+        float s = m * m * R * R / (4.0f * ai * ai * h);
+        if (s <= h)
+            best = maxf(best, ai * s + m * R * sqrtf(s / h));
+    }
+    return best;
+}
+
+// Pontos doboz: tengelyenkent a palast szelsoerteke a csucs es a fedolap pereme kozott
+inline AABB paraboloidBounds(Paraboloid &pb) {
+    float R = sqrtf(pb.k * pb.h);
+    float lo[3], hi[3];
+    for (int i = 0; i < 3; i++) {
+        float ai = pb.axis[i], m = perpendicularReach(ai);
+        lo[i] = pb.apex[i] - paraboloidReach(-ai, m, R, pb.h);
+        hi[i] = pb.apex[i] + paraboloidReach(ai, m, R, pb.h);
+    }
+    return AABB(Point(lo[0], lo[1], lo[2]), Point(hi[0], hi[1], hi[2]));
+}
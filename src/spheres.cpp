@@ -0,0 +1,152 @@
+#if defined(__AVX512F__) || defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+//--------------------------------------------------------
+// SphereSet
+//--------------------------------------------------------
+// Gombok SoA tarolasa: a kozeppontok es a sugarnegyzetek kulon tombokben, SPHERE_LANES tobbszorosere
+// kiegeszitett blokkokban, igy egy sugarat egyetlen utasitassal 16 (AVX-512), 8 (AVX) vagy 4 (SSE) gombbal metszunk.
+#if defined(__AVX512F__)
+static const int SPHERE_LANES = 16;
+#elif defined(__AVX__)
+static const int SPHERE_LANES = 8;
+#elif defined(__SSE2__)
+static const int SPHERE_LANES = 4;
+#else
+static const int SPHERE_LANES = 1;
+#endif
+
+class SphereSet {
+    DynamicArray<float> cx, cy, cz, r2;
+    DynamicArray<ObjectHandle> objects;
+
+    // Egy blokk (SPHERE_LANES gomb) kisebbik gyoke, ugyanazzal a keplettel, mint ObjectStore::intersectSphere.
+    // A savba FLOAT_MAX kerul, ha nincs valos gyok, vagy az nem esik (tmin, tmax) koze.
+    void roots(int first, Ray &ray, float tmin, float tmax, float *t) {
+        const float *cx = this->cx.data(), *cy = this->cy.data(), *cz = this->cz.data(), *r2 = this->r2.data();
+        float a = ray.v * ray.v;
+#if defined(__AVX512F__)
+        __m512 ox = _mm512_set1_ps(ray.p0.x), oy = _mm512_set1_ps(ray.p0.y), oz = _mm512_set1_ps(ray.p0.z);
+        __m512 dx = _mm512_set1_ps(ray.v.x), dy = _mm512_set1_ps(ray.v.y), dz = _mm512_set1_ps(ray.v.z);
+        __m512 tx = _mm512_sub_ps(ox, _mm512_loadu_ps(cx + first));
+        __m512 ty = _mm512_sub_ps(oy, _mm512_loadu_ps(cy + first));
+        __m512 tz = _mm512_sub_ps(oz, _mm512_loadu_ps(cz + first));
+        __m512 b = _mm512_mul_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(tx, dx), _mm512_mul_ps(ty, dy)), _mm512_mul_ps(tz, dz)), _mm512_set1_ps(2.0f));
+        __m512 c = _mm512_sub_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(tx, tx), _mm512_mul_ps(ty, ty)), _mm512_mul_ps(tz, tz)), _mm512_loadu_ps(r2 + first));
+        __m512 disc = _mm512_sub_ps(_mm512_mul_ps(b, b), _mm512_mul_ps(_mm512_set1_ps(4.0f * a), c));
+        __m512 root = _mm512_div_ps(_mm512_sub_ps(_mm512_sub_ps(_mm512_setzero_ps(), b), _mm512_sqrt_ps(disc)), _mm512_set1_ps(2.0f * a));
+        __mmask16 valid = _mm512_cmp_ps_mask(disc, _mm512_setzero_ps(), _CMP_GE_OQ)
+                          & _mm512_cmp_ps_mask(root, _mm512_set1_ps(tmin), _CMP_GT_OQ)
+                          & _mm512_cmp_ps_mask(root, _mm512_set1_ps(tmax), _CMP_LT_OQ);
+        _mm512_storeu_ps(t, _mm512_mask_blend_ps(valid, _mm512_set1_ps(FLOAT_MAX), root));
+#elif defined(__AVX__)
+        __m256 ox = _mm256_set1_ps(ray.p0.x), oy = _mm256_set1_ps(ray.p0.y), oz = _mm256_set1_ps(ray.p0.z);
+        __m256 dx = _mm256_set1_ps(ray.v.x), dy = _mm256_set1_ps(ray.v.y), dz = _mm256_set1_ps(ray.v.z);
+        __m256 tx = _mm256_sub_ps(ox, _mm256_loadu_ps(cx + first));
+        __m256 ty = _mm256_sub_ps(oy, _mm256_loadu_ps(cy + first));
+        __m256 tz = _mm256_sub_ps(oz, _mm256_loadu_ps(cz + first));
+        __m256 b = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(tx, dx), _mm256_mul_ps(ty, dy)), _mm256_mul_ps(tz, dz)), _mm256_set1_ps(2.0f));
+        __m256 c = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(tx, tx), _mm256_mul_ps(ty, ty)), _mm256_mul_ps(tz, tz)), _mm256_loadu_ps(r2 + first));
+        __m256 disc = _mm256_sub_ps(_mm256_mul_ps(b, b), _mm256_mul_ps(_mm256_set1_ps(4.0f * a), c));
+        __m256 root = _mm256_div_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_setzero_ps(), b), _mm256_sqrt_ps(disc)), _mm256_set1_ps(2.0f * a));
+        __m256 valid = _mm256_and_ps(_mm256_cmp_ps(disc, _mm256_setzero_ps(), _CMP_GE_OQ),
+                                     _mm256_and_ps(_mm256_cmp_ps(root, _mm256_set1_ps(tmin), _CMP_GT_OQ),
+                                                   _mm256_cmp_ps(root, _mm256_set1_ps(tmax), _CMP_LT_OQ)));
+        _mm256_storeu_ps(t, _mm256_blendv_ps(_mm256_set1_ps(FLOAT_MAX), root, valid));
+#elif defined(__SSE2__)
+        __m128 ox = _mm_set1_ps(ray.p0.x), oy = _mm_set1_ps(ray.p0.y), oz = _mm_set1_ps(ray.p0.z);
+        __m128 dx = _mm_set1_ps(ray.v.x), dy = _mm_set1_ps(ray.v.y), dz = _mm_set1_ps(ray.v.z);
+        __m128 tx = _mm_sub_ps(ox, _mm_loadu_ps(cx + first));
+        __m128 ty = _mm_sub_ps(oy, _mm_loadu_ps(cy + first));
+        __m128 tz = _mm_sub_ps(oz, _mm_loadu_ps(cz + first));
+        __m128 b = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, dx), _mm_mul_ps(ty, dy)), _mm_mul_ps(tz, dz)), _mm_set1_ps(2.0f));
+        __m128 c = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, tx), _mm_mul_ps(ty, ty)), _mm_mul_ps(tz, tz)), _mm_loadu_ps(r2 + first));
+        __m128 disc = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(_mm_set1_ps(4.0f * a), c));
+        __m128 root = _mm_div_ps(_mm_sub_ps(_mm_sub_ps(_mm_setzero_ps(), b), _mm_sqrt_ps(disc)), _mm_set1_ps(2.0f * a));
+        __m128 valid = _mm_and_ps(_mm_cmpge_ps(disc, _mm_setzero_ps()),
+                                  _mm_and_ps(_mm_cmpgt_ps(root, _mm_set1_ps(tmin)), _mm_cmplt_ps(root, _mm_set1_ps(tmax))));
+        _mm_storeu_ps(t, _mm_or_ps(_mm_and_ps(valid, root), _mm_andnot_ps(valid, _mm_set1_ps(FLOAT_MAX))));
+#else
+        for (int i = 0; i < SPHERE_LANES; i++) {
+            float tx = ray.p0.x - cx[first + i], ty = ray.p0.y - cy[first + i], tz = ray.p0.z - cz[first + i];
+            float b = (tx * ray.v.x + ty * ray.v.y + tz * ray.v.z) * 2.0f;
+            float c = (tx * tx + ty * ty + tz * tz) - r2[first + i];
+            float disc = b * b - 4.0f * a * c;
+            float root = (-1.0f * b - sqrtf(disc)) / (2.0f * a);
+            t[i] = (disc >= 0.0f && root > tmin && root < tmax) ? root : FLOAT_MAX;
+        }
+#endif
+    }
+
+public:
+    int size() {
+        return objects.size;
+    }
+
+    void reserve(int n) {
+        cx.reserve(n);
+        cy.reserve(n);
+        cz.reserve(n);
+        r2.reserve(n);
+        objects.reserve(n);
+    }
+
+    void push(Point center, float r, ObjectHandle object) {
+        cx.push(center.x);
+        cy.push(center.y);
+        cz.push(center.z);
+        r2.push(r * r);
+        objects.push(object);
+    }
+
+    // A blokk vegere olyan gombok kerulnek, amelyeknek sosincs valos gyoke (c nagy pozitiv, igy disc < 0)
+    void pad() {
+        while (objects.size % SPHERE_LANES != 0) {
+            cx.push(0.0f);
+            cy.push(0.0f);
+            cz.push(0.0f);
+            r2.push(-FLOAT_MAX);
+            objects.push(NO_OBJECT);
+        }
+    }
+
+    void clear() {
+        cx.clear();
+        cy.clear();
+        cz.clear();
+        r2.clear();
+        objects.clear();
+    }
+
+    // A first indextol n gomb kozul a legkozelebbi, (tmin, t) kozotti talalat; t es o csak talalatnal valtozik
+    bool intersect(int first, int n, Ray &ray, float tmin, float &t, ObjectHandle &o) {
+        alignas(64) float roots_[SPHERE_LANES];
+        bool intersected = false;
+
+        for (int block = first; block < first + n; block += SPHERE_LANES) {
+            roots(block, ray, tmin, t, roots_);
+            for (int i = 0; i < SPHERE_LANES; i++) {
+                if (roots_[i] < t) {
+                    t = roots_[i];
+                    o = objects[block + i];
+                    intersected = true;
+                }
+            }
+        }
+        return intersected;
+    }
+
+    bool occluded(int first, int n, Ray &ray, float tmin, float tmax) {
+        alignas(64) float roots_[SPHERE_LANES];
+
+        for (int block = first; block < first + n; block += SPHERE_LANES) {
+            roots(block, ray, tmin, tmax, roots_);
+            for (int i = 0; i < SPHERE_LANES; i++) {
+                if (roots_[i] < tmax)
+                    return true;
+            }
+        }
+        return false;
+    }
+};
@@ -0,0 +1,97 @@
+#include <stdio.h>
+
+//--------------------------------------------------------
+// RayStats
+//--------------------------------------------------------
+// Szalankenti szamlalok: a tracer a thread_local rayStats-ot noveli atomikus muveletek nelkul, a hivo
+// tile-onkent a worker sajat RayStats-aba gyujti (collect), a szalak utan pedig osszefesuli (merge) oket.
+// GRAFIKA_STATS nelkul a RAY_STAT makrok ures utasitasok, a szamlalok nem kerulnek semmibe.
+struct RayStats {
+    unsigned long primaryRays;
+    unsigned long shadowRays;
+    unsigned long reflectionRays;
+    unsigned long refractionRays;
+    unsigned long intersectionTests;    // sugar-objektum parok, amikre a metszest kiszamoltuk
+    unsigned long bvRejects;            // ezekbol ennyit a befoglalo gomb mar a gyokkereses elott elutasitott
+    unsigned long depthHistogram[MAX_TRACE_DEPTH + 2];    // kovetett (nem arnyek) sugarak melyseg szerint
+
+    RayStats() {
+        clear();
+    }
+
+    void clear() {
+        primaryRays = shadowRays = reflectionRays = refractionRays = 0;
+        intersectionTests = bvRejects = 0;
+        for (int i = 0; i < MAX_TRACE_DEPTH + 2; i++)
+            depthHistogram[i] = 0;
+    }
+
+    void merge(const RayStats &s) {
+        primaryRays += s.primaryRays;
+        shadowRays += s.shadowRays;
+        reflectionRays += s.reflectionRays;
+        refractionRays += s.refractionRays;
+        intersectionTests += s.intersectionTests;
+        bvRejects += s.bvRejects;
+        for (int i = 0; i < MAX_TRACE_DEPTH + 2; i++)
+            depthHistogram[i] += s.depthHistogram[i];
+    }
+
+    unsigned long totalRays() const {
+        return primaryRays + shadowRays + reflectionRays + refractionRays;
+    }
+
+    // Ahany sugarat a World::trace/integrate tenylegesen kovetett (arnyeksugarak nelkul)
+    unsigned long tracedRays() const {
+        unsigned long n = 0;
+        for (int i = 0; i < MAX_TRACE_DEPTH + 2; i++)
+            n += depthHistogram[i];
+        return n;
+    }
+
+    // Az aktualis szal szamlaloit hozzaadja a target-hez es lenullazza oket
+    static void collect(RayStats &target);
+
+    // Az aktualis szal szamlaloi; GRAFIKA_STATS nelkul mindig nullak
+    static const RayStats &current();
+
+    void print(FILE *f, double seconds) const {
+        fprintf(f, "rays: %lu primary, %lu shadow, %lu reflection, %lu refraction, %lu total\n",
+                primaryRays, shadowRays, reflectionRays, refractionRays, totalRays());
+        fprintf(f, "intersection tests: %lu, bounding sphere rejects: %lu\n", intersectionTests, bvRejects);
+        if (seconds > 0.0)
+            fprintf(f, "%.2f Mrays/s\n", totalRays() / seconds / 1e6);
+
+        int last = MAX_TRACE_DEPTH + 1;
+        while (last > 0 && depthHistogram[last] == 0) last--;
+        for (int d = 0; d <= last; d++)
+            fprintf(f, "  depth %2d: %lu\n", d, depthHistogram[d]);
+    }
+};
+
+#if defined(GRAFIKA_STATS)
+static thread_local RayStats rayStats;
+
+void RayStats::collect(RayStats &target) {
+    target.merge(rayStats);
+    rayStats.clear();
+}
+
+const RayStats &RayStats::current() {
+    return rayStats;
+}
+
+#define RAY_STAT(field) (rayStats.field++)
+#define RAY_STAT_ADD(field, n) (rayStats.field += (n))
+#else
+void RayStats::collect(RayStats &target) {
+}
+
+const RayStats &RayStats::current() {
+    static const RayStats empty;
+    return empty;
+}
+
+#define RAY_STAT(field) ((void) 0)
+#define RAY_STAT_ADD(field, n) ((void) 0)
+#endif